@@ -0,0 +1,50 @@
+#pragma once
+#include <cfloat>
+#include "glm/glm.hpp"
+#include "ray.h"
+
+// Axis-aligned bounding box. Default constructed boxes are empty and grow with expand()
+struct aabb {
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	aabb() {}
+	aabb(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+	void expand(const glm::vec3& p) {
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	void expand(const aabb& b) {
+		min = glm::min(min, b.min);
+		max = glm::max(max, b.max);
+	}
+
+	bool empty() const { return min.x > max.x; }
+
+	glm::vec3 centroid() const { return 0.5f * (min + max); }
+
+	float surfaceArea() const {
+		if (empty()) return 0.0f;
+		glm::vec3 e = max - min;
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	// Slab test against a ray, clipped to [0, tMax]. Returns the entry distance, or FLT_MAX if the box is missed
+	// or lies beyond tMax. The direction signs pick the near and far plane per axis, so no min/max is needed
+	float intersect(const ray& r, float tMax) const {
+		const glm::vec3& origin = r.origin();
+		const glm::vec3& invDir = r.invDirection();
+		float txNear = ((r.negative(0) ? max.x : min.x) - origin.x) * invDir.x;
+		float txFar = ((r.negative(0) ? min.x : max.x) - origin.x) * invDir.x;
+		float tyNear = ((r.negative(1) ? max.y : min.y) - origin.y) * invDir.y;
+		float tyFar = ((r.negative(1) ? min.y : max.y) - origin.y) * invDir.y;
+		float tzNear = ((r.negative(2) ? max.z : min.z) - origin.z) * invDir.z;
+		float tzFar = ((r.negative(2) ? min.z : max.z) - origin.z) * invDir.z;
+		float tEnter = glm::max(glm::max(txNear, tyNear), glm::max(tzNear, 0.0f));
+		// Widening the exit by a few ulps keeps rounding from dropping grazing hits on primitives touching the box
+		float tExit = glm::min(glm::min(txFar, tyFar), tzFar) * 1.0000004f;
+		return tEnter <= glm::min(tExit, tMax) ? tEnter : FLT_MAX;
+	}
+};
@@ -0,0 +1,24 @@
+#include "accelerator.h"
+#include <cstring>
+#include "bvh.h"
+#include "grid.h"
+#include "kdtree.h"
+
+std::unique_ptr<accelerator> createAccelerator(acceleratorType type) {
+	switch (type) {
+	case acceleratorType::grid:
+		return std::unique_ptr<accelerator>(new uniformGrid());
+	case acceleratorType::kdtree:
+		return std::unique_ptr<accelerator>(new kdTree());
+	default:
+		return std::unique_ptr<accelerator>(new bvh());
+	}
+}
+
+bool parseAcceleratorType(const char* name, acceleratorType& type) {
+	if (std::strcmp(name, "bvh") == 0) type = acceleratorType::bvh;
+	else if (std::strcmp(name, "grid") == 0) type = acceleratorType::grid;
+	else if (std::strcmp(name, "kdtree") == 0) type = acceleratorType::kdtree;
+	else return false;
+	return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "aabb.h"
+#include "ray.h"
+
+// Primitive tests an accelerator calls back into while traversing
+class primitiveIntersector
+{
+public:
+	virtual ~primitiveIntersector() {}
+	// Closest-hit test; on a hit closer than tMax, records it, shrinks tMax and returns true
+	virtual bool intersect(int index, const ray& r, float& tMax) const = 0;
+	// Returns true if the primitive blocks the ray anywhere before tMax
+	virtual bool occluded(int index, const ray& r, float tMax) const = 0;
+};
+
+// Spatial index over a list of primitive bounds, queried through a primitiveIntersector
+class accelerator
+{
+public:
+	virtual ~accelerator() {}
+
+	virtual const char* name() const = 0;
+
+	virtual void build(const std::vector<aabb>& primBounds) = 0;
+	// Brings the structure up to date after primitives moved. Returns true if it had to rebuild.
+	// Structures without a cheaper update path simply rebuild
+	virtual bool update(const std::vector<aabb>& primBounds) { build(primBounds); return true; }
+
+	// Finds the closest hit before tMax, shrinking tMax to its distance
+	virtual bool intersectClosest(const ray& r, float& tMax, const primitiveIntersector& prims) const = 0;
+	// Returns as soon as any primitive blocks the ray before tMax
+	virtual bool intersectAny(const ray& r, float tMax, const primitiveIntersector& prims) const = 0;
+
+	virtual size_t memoryUsage() const = 0;
+};
+
+enum class acceleratorType { bvh, grid, kdtree };
+
+std::unique_ptr<accelerator> createAccelerator(acceleratorType type);
+
+// Parses "bvh", "grid" or "kdtree". Returns false for anything else
+bool parseAcceleratorType(const char* name, acceleratorType& type);
@@ -0,0 +1,34 @@
+#include "allocationCounter.h"
+
+#ifndef NDEBUG
+#include <cstdlib>
+#include <new>
+
+namespace {
+	thread_local long long allocations = 0;
+}
+
+long long threadAllocationCount() {
+	return allocations;
+}
+
+// new[] and the nothrow forms forward to this one, so all of them are counted
+void* operator new(std::size_t bytes) {
+	++allocations;
+	if (void* p = std::malloc(bytes ? bytes : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+#else
+long long threadAllocationCount() {
+	return 0;
+}
+#endif
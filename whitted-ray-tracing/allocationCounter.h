@@ -0,0 +1,19 @@
+#pragma once
+#include <cassert>
+
+// Debug builds replace the global operator new to count heap allocations per thread, so hot loops can check
+// that they only use preallocated or arena memory. Release builds keep the standard allocator and return 0
+long long threadAllocationCount();
+
+// Asserts that the current thread makes no heap allocation while the guard is in scope (debug builds only)
+class heapAllocationGuard
+{
+#ifndef NDEBUG
+public:
+	heapAllocationGuard() : start(threadAllocationCount()) {}
+	~heapAllocationGuard() { assert(threadAllocationCount() == start && "heap allocation inside the render loop"); }
+
+private:
+	long long start;
+#endif
+};
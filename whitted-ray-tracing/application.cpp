@@ -6,71 +6,241 @@
 #include <vector>
 #include "ray.h"
 
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <fstream>
+#include "benchmark.h"
 #include "camera.h"
-
-    struct HitInfo {
-        bool hit;
-        float t;
-        glm::vec3 hitPoint;
-        glm::vec3 normal;
-    };
+#include "checkpoint.h"
+#include "frameStream.h"
+#include "hdrOutput.h"
+#include "imageOutput.h"
+#include "mappedImage.h"
+#include "outputQueue.h"
+#include "renderer.h"
+#include "scene.h"
+#include "scenes.h"
 
     colorRGB ray_color(const ray& r) {
         glm::vec3 unit_direction = glm::normalize(r.direction());
         auto a = 0.5 * (unit_direction.y + 1.0);
         return (1.0 - a) * colorRGB(1.0, 1.0, 1.0) + a * colorRGB(0.5, 0.7, 1.0);
     }
-    bool hit_sphere(const glm::vec3& center, double radius, const ray& r) {
-        glm::vec3 oc = r.origin() - center;
-        auto a = dot(r.direction(), r.direction());
-        auto b = 2.0 * dot(oc, r.direction());
-        auto c = dot(oc, oc) - radius * radius;
-        auto discriminant = b * b - 4 * a * c;
-        return (discriminant >= 0);
-    }
 
-    colorRGB shade(const HitInfo & info) {
-        // Simple shading: return red color for hits, else return background color
-        return info.hit ? colorRGB(1.0f, 0.0f, 0.0f) : colorRGB();
+    bool endsWith(const char* name, const char* suffix) {
+        size_t length = std::strlen(name), suffixLength = std::strlen(suffix);
+        return length >= suffixLength && std::strcmp(name + length - suffixLength, suffix) == 0;
     }
 
-    void saveAsPPM(const std::vector<std::vector<colorRGB>>&pixelData, int width, int height, const char* filename) {
-        std::cout << "Saving image.";
-        std::ofstream img(filename);
-        img << "P3" << std::endl;
-        img << width << " " << height << std::endl;
-        img << "255" << std::endl;
-
-        int dotSegment = floor(height / 8);
-        int dotCounter = 0;
-
-        for (int i = 0; i < height; ++i) {
-            for (int j = 0; j < width; ++j) {
-                int r = static_cast<int>(pixelData[i][j].r * 255.0f);
-                int g = static_cast<int>(pixelData[i][j].g * 255.0f);
-                int b = static_cast<int>(pixelData[i][j].b * 255.0f);
+    // The format follows the file extension: .png, .qoi, .hdr and .exr, anything else is a PPM. The HDR formats keep
+    // the float framebuffer as it is and ignore tonemapping
+    bool saveImage(const std::vector<std::vector<colorRGB>>&pixelData, const char* filename, ppmFormat format, const tonemapSettings& tonemap) {
+        std::cout << "Saving image..." << std::endl;
+        bool written = endsWith(filename, ".png") ? writePNG(filename, pixelData, tonemap)
+            : endsWith(filename, ".qoi") ? writeQOI(filename, pixelData, tonemap)
+            : endsWith(filename, ".hdr") ? writeRadianceHDR(filename, pixelData)
+            : endsWith(filename, ".exr") ? writeEXR(filename, pixelData)
+            : writePPM(filename, pixelData, format, tonemap);
+        if (!written) {
+            std::cerr << "Could not write '" << filename << "'" << std::endl;
+            return false;
+        }
+        std::cout << "Image saved as '" << filename << "'" << std::endl;
+        return true;
+    }
 
-                img << r << " " << g << " " << b << std::endl;
+    int main(int argc, char* argv[]) {
+        acceleratorType accelType = acceleratorType::bvh;
+        renderSettings settings;
+        bool whitted = false;
+        std::vector<const char*> outputNames;
+        ppmFormat outputFormat = ppmFormat::binary;
+        tonemapSettings tonemap;
+        int streamRows = 0;
+        bool mapped = false;
+        const char* checkpointName = nullptr;
+        double checkpointInterval = 60.0;
+        bool resume = false;
+        bool progressive = false;
+        int frameCount = 0;
+        const char* streamPath = "-";
+        streamFormat frameFormat = streamFormat::y4m;
+        int framesPerSecond = 24;
+        for (int arg = 1; arg < argc; ++arg) {
+            if (std::strcmp(argv[arg], "--accel") == 0 && arg + 1 < argc) {
+                if (!parseAcceleratorType(argv[++arg], accelType)) {
+                    std::cerr << "Unknown accelerator '" << argv[arg] << "', expected bvh, grid or kdtree" << std::endl;
+                    return 1;
+                }
             }
-
-            dotCounter++;
-            if (dotCounter >= dotSegment)
-            {
-                if (i <= height - dotSegment)
-                {
-                    std::cout << ".";
-                    dotCounter = 0;
+            else if (std::strcmp(argv[arg], "--scene") == 0 && arg + 1 < argc) {
+                whitted = std::strcmp(argv[++arg], "whitted") == 0;
+                if (!whitted && std::strcmp(argv[arg], "circle") != 0) {
+                    std::cerr << "Unknown scene '" << argv[arg] << "', expected circle or whitted" << std::endl;
+                    return 1;
+                }
+            }
+            else if (std::strcmp(argv[arg], "--depth") == 0 && arg + 1 < argc) {
+                settings.maxDepth = glm::clamp(std::atoi(argv[++arg]), 0, maxTraceDepth);
+            }
+            else if (std::strcmp(argv[arg], "--min-contribution") == 0 && arg + 1 < argc) {
+                settings.minContribution = std::atof(argv[++arg]);
+            }
+            else if (std::strcmp(argv[arg], "--aa") == 0 && arg + 1 < argc) {
+                const char* mode = argv[++arg];
+                if (std::strcmp(mode, "none") == 0) settings.antialiasing = antialiasMode::none;
+                else if (std::strcmp(mode, "uniform") == 0) settings.antialiasing = antialiasMode::uniform;
+                else if (std::strcmp(mode, "adaptive") == 0) settings.antialiasing = antialiasMode::adaptive;
+                else {
+                    std::cerr << "Unknown antialiasing mode '" << mode << "', expected none, uniform or adaptive" << std::endl;
+                    return 1;
+                }
+            }
+            else if (std::strcmp(argv[arg], "--samples") == 0 && arg + 1 < argc) {
+                settings.samplesPerAxis = std::atoi(argv[++arg]);
+            }
+            else if (std::strcmp(argv[arg], "--output") == 0 && arg + 1 < argc) {
+                // May be given several times; every output is written from the same render
+                outputNames.push_back(argv[++arg]);
+            }
+            else if (std::strcmp(argv[arg], "--format") == 0 && arg + 1 < argc) {
+                if (!parsePPMFormat(argv[++arg], outputFormat)) {
+                    std::cerr << "Unknown output format '" << argv[arg] << "', expected p3 or p6" << std::endl;
+                    return 1;
+                }
+            }
+            else if (std::strcmp(argv[arg], "--exposure") == 0 && arg + 1 < argc) {
+                tonemap.exposure = static_cast<float>(std::atof(argv[++arg]));
+            }
+            else if (std::strcmp(argv[arg], "--linear") == 0) {
+                tonemap.srgb = false;
+            }
+            else if (std::strcmp(argv[arg], "--stream-rows") == 0 && arg + 1 < argc) {
+                streamRows = std::atoi(argv[++arg]);
+            }
+            else if (std::strcmp(argv[arg], "--mmap") == 0) {
+                mapped = true;
+            }
+            else if (std::strcmp(argv[arg], "--checkpoint") == 0 && arg + 1 < argc) {
+                checkpointName = argv[++arg];
+            }
+            else if (std::strcmp(argv[arg], "--checkpoint-interval") == 0 && arg + 1 < argc) {
+                checkpointInterval = std::atof(argv[++arg]);
+            }
+            else if (std::strcmp(argv[arg], "--resume") == 0) {
+                resume = true;
+            }
+            else if (std::strcmp(argv[arg], "--progressive") == 0) {
+                progressive = true;
+            }
+            else if (std::strcmp(argv[arg], "--frames") == 0 && arg + 1 < argc) {
+                frameCount = std::atoi(argv[++arg]);
+            }
+            else if (std::strcmp(argv[arg], "--stream-to") == 0 && arg + 1 < argc) {
+                streamPath = argv[++arg];
+            }
+            else if (std::strcmp(argv[arg], "--stream-format") == 0 && arg + 1 < argc) {
+                if (!parseStreamFormat(argv[++arg], frameFormat)) {
+                    std::cerr << "Unknown stream format '" << argv[arg] << "', expected p6 or y4m" << std::endl;
+                    return 1;
                 }
             }
+            else if (std::strcmp(argv[arg], "--fps") == 0 && arg + 1 < argc) {
+                framesPerSecond = std::atoi(argv[++arg]);
+            }
+            else if (std::strcmp(argv[arg], "--bench-accel") == 0) {
+                runAcceleratorBenchmark(512, 512);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-refit") == 0) {
+                runRefitBenchmark(100);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-shadows") == 0) {
+                runShadowCacheBenchmark(512, 512);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-pruning") == 0) {
+                runPruningBenchmark(512, 512);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-aa") == 0) {
+                runAntialiasBenchmark(256, 256);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-shading") == 0) {
+                runShadingBenchmark(512, 512);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-lights") == 0) {
+                runLightCullingBenchmark(512, 512);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-write") == 0) {
+                // Optional largest frame size
+                int maxSize = arg + 1 < argc && argv[arg + 1][0] != '-' ? std::atoi(argv[++arg]) : 16384;
+                runImageWriteBenchmark(maxSize);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-stream") == 0) {
+                runStreamingBenchmark(1024, 1024);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-compression") == 0) {
+                runCompressionBenchmark(1024, 1024);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-hdr") == 0) {
+                runHDROutputBenchmark(1024, 1024);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-io") == 0) {
+                runOutputQueueBenchmark(512, 512, 6);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-progressive") == 0) {
+                runProgressiveBenchmark(512, 512);
+                return 0;
+            }
+            else if (std::strcmp(argv[arg], "--bench-mmap") == 0) {
+                runMappedOutputBenchmark(2048, 2048);
+                return 0;
+            }
+            else {
+                std::cerr << "Usage: " << argv[0] << " [--accel bvh|grid|kdtree] [--scene circle|whitted] [--depth n] [--min-contribution w] [--aa none|uniform|adaptive] [--samples n] [--output file.ppm|png|qoi|hdr|exr]... [--format p3|p6] [--exposure stops] [--linear] [--stream-rows n] [--mmap] [--checkpoint file] [--checkpoint-interval seconds] [--resume] [--progressive] [--frames n] [--stream-to path|-] [--stream-format p6|y4m] [--fps n] [--bench-accel] [--bench-refit] [--bench-shadows] [--bench-pruning] [--bench-aa] [--bench-shading] [--bench-lights] [--bench-write [max size]] [--bench-stream] [--bench-mmap] [--bench-compression] [--bench-hdr] [--bench-io] [--bench-progressive]" << std::endl;
+                return 1;
+            }
+        }
+        if (frameCount > 0 && !outputNames.empty()) {
+            std::cerr << "--frames writes to the --stream-to path, it cannot be combined with --output" << std::endl;
+            return 1;
+        }
+        if (outputNames.empty())
+            outputNames.push_back("circle_red.ppm");
+        if (mapped && outputNames.size() > 1) {
+            std::cerr << "--mmap writes a single output" << std::endl;
+            return 1;
+        }
+        if (checkpointName && (mapped || streamRows > 0)) {
+            std::cerr << "--checkpoint needs the full framebuffer, it cannot be combined with --mmap or --stream-rows" << std::endl;
+            return 1;
+        }
+        if (progressive && (mapped || streamRows > 0 || checkpointName)) {
+            std::cerr << "--progressive renders into the full framebuffer, it cannot be combined with --mmap, --stream-rows or --checkpoint" << std::endl;
+            return 1;
+        }
+        if (frameCount > 0 && (mapped || streamRows > 0 || checkpointName || progressive)) {
+            std::cerr << "--frames cannot be combined with --mmap, --stream-rows, --checkpoint or --progressive" << std::endl;
+            return 1;
+        }
+        if (resume && !checkpointName) {
+            std::cerr << "--resume needs the --checkpoint file to resume from" << std::endl;
+            return 1;
         }
 
-        std::cout << std::endl;
-        std::cout << "Image saved as '" << filename << "'" << std::endl;
-    }
-
-    int main() {
         // Image dimentions
         int imageWidth = 600;
         float aspectRatio = 1 / 1;
@@ -80,58 +250,156 @@
         //std::vector<std::vector<glm::vec3>> pixelData(imageHeight, std::vector<glm::vec3>(imageWidth, backgroundColor));
 
         glm::vec3 sphereCenter(0.0f, 0.0f, 0.0f);
-        double sphereRadius = 0.2f;
+        float sphereRadius = 0.2f;
 
         // Camera setup
         glm::vec3 cameraPosition(0.0f, 0.0f, -50.0f);  // Position of the camera
         glm::vec3 cameraTarget(0.0f, 0.0f, 0.0f);    // Point the camera is looking at
         glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);        // Up direction of the camera
-        camera cam = camera(imageWidth, imageHeight, cameraPosition, cameraTarget, cameraUp);
-
-        // Iterate over pixels
-        for (int i = 0; i < imageHeight; ++i) {
-            // Progress indicator
-            std::clog << "\rScanlines remaining: " << (imageHeight - i) << ' ' << std::flush;
-            for (int j = 0; j < imageWidth; ++j) {
-                // Calculate normalized device coordinates (NDC) for the pixel
-                float ndcX = (2.0f * static_cast<float>(j) / static_cast<float>(imageWidth)) - 1.0f;
-                float ndcY = 1.0f - (2.0f * static_cast<float>(i) / static_cast<float>(imageHeight));
-
-                // Create a ray direction vector in camera space
-                glm::vec4 rayDirectionCameraSpace(ndcX, ndcY, -1.0f, 1.0f); // The -1.0f is the direction along the negative Z-axis
-                glm::vec4 rayDirectionWorldSpace = glm::inverse(cam.getMatrix()) * rayDirectionCameraSpace;
-
-                // Normalize the ray direction
-                glm::vec3 rayDirection = glm::normalize(glm::vec3(rayDirectionWorldSpace));
 
-                // Set the ray origin to the camera position
-                ray ray(cameraPosition, rayDirection);
-
-                // Perform ray-box intersection and shading as described in the previous example
-                HitInfo hitInfo;
-                hitInfo.hit = hit_sphere(sphereCenter, sphereRadius, ray);
-                cam.pixels[j][i] = shade(hitInfo);
-
-                //// Calculate the pixel center in world space
-                //glm::vec3 pixel_center = cam.cameraPosition + glm::vec3(i, j, 0);
-
-                //// Create a ray from the camera position to the pixel center
-                //glm::vec3 ray_direction = glm::normalize(pixel_center - cam.cameraPosition);
-                //ray r(cam.cameraPosition, ray_direction);
-
-                //// Calculate the color of the pixel by tracing the ray
-                //colorRGB pixel_color = ray_color(r);
+        scene world;
+        if (whitted) {
+            sceneView view = buildWhittedScene(world);
+            cameraPosition = view.position;
+            cameraTarget = view.target;
+        }
+        else {
+            material red;
+            red.diffuse = colorRGB(1.0, 0.0, 0.0);
+            world.materials.add(red);
+            world.spheres.push_back(sphere(sphereCenter, sphereRadius));
+            world.lights.push_back({ glm::vec3(-20.0f, 30.0f, -60.0f), colorRGB(0.9f, 0.9f, 0.9f) });
+            world.build();
+        }
+        if (accelType != acceleratorType::bvh)
+            world.setAccelerator(accelType);
 
-                ////std::clog << "\r(" << pixel_color.r << ", " << pixel_color.g << ", " << pixel_color.b << ")" << std::flush;
+        // Streaming renders keep only streamRows scanlines in memory and write each band as it finishes; animations
+        // render every frame into a camera of its own
+        camera cam = camera(imageWidth, imageHeight, cameraPosition, cameraTarget, cameraUp, streamRows <= 0 && !mapped && frameCount <= 0);
 
-                //// Write the color to the pixel data array
-                //cam.pixels[j][i] = pixel_color;
+        settings.showProgress = true;
+        if (mapped) {
+            // Render threads quantize each finished scanline into the mapped P6 file themselves
+            const char* outputName = outputNames[0];
+            mappedPPM image;
+            if (!image.create(outputName, imageWidth, imageHeight)) {
+                std::cerr << "Could not create '" << outputName << "'" << std::endl;
+                return 1;
+            }
+            renderStats stats = renderScanlines(world, cam, settings, [&](int y, const colorRGB* pixels) {
+                quantizeRow(pixels, imageWidth, tonemap, image.row(y));
+            });
+            std::clog << "\rDone.                 \n";
+            stats.print(std::clog);
+            if (!image.close()) {
+                std::cerr << "Could not write '" << outputName << "'" << std::endl;
+                return 1;
+            }
+            std::cout << "Image saved as '" << outputName << "'" << std::endl;
+            return 0;
+        }
+        // Encoding and writing run on the output thread, overlapping the rest of the render when streaming. The
+        // process ends once it has flushed the last output
+        outputQueue outputs;
+        if (frameCount > 0) {
+            // Orbits the camera around its target. The output thread converts and writes each frame while the next
+            // one renders; a reader falling behind by more than the queue holds makes the next submit wait
+            frameStream stream;
+            if (!stream.open(streamPath, imageWidth, imageHeight, frameFormat, framesPerSecond)) {
+                std::cerr << "Could not open '" << streamPath << "'" << std::endl;
+                return 1;
             }
+            settings.showProgress = false;
+            renderStats stats;
+            for (int frame = 0; frame < frameCount && !outputs.anyFailed(); ++frame) {
+                float angle = 2.0f * glm::pi<float>() * frame / frameCount;
+                glm::vec3 position = cameraTarget + glm::vec3(glm::rotate(glm::mat4(1.0f), angle, cameraUp) * glm::vec4(cameraPosition - cameraTarget, 0.0f));
+                camera frameCamera(imageWidth, imageHeight, position, cameraTarget, cameraUp);
+                stats += render(world, frameCamera, settings);
+                outputs.submitImage(std::move(frameCamera.pixels), [&](const std::vector<std::vector<colorRGB>>& pixels) {
+                    return stream.writeFrame(pixels, tonemap);
+                });
+                std::clog << "\rFrames rendered: " << frame + 1 << " of " << frameCount << ' ' << std::flush;
+            }
+            bool written = outputs.finish();
+            written = stream.close() && written;
+            std::clog << "\rDone.                 \n";
+            stats.print(std::clog);
+            std::clog << "Frames written: " << stream.framesWritten() << ", rendering waited " << outputs.blockedSeconds() * 1e3 << " ms on the output" << std::endl;
+            if (!written) {
+                std::cerr << "Could not write to '" << streamPath << "'" << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+        if (streamRows > 0) {
+            // Every output gets the bands as P6 or P3 whatever its extension
+            std::vector<std::unique_ptr<ppmStreamWriter>> writers;
+            std::vector<scanlineSink*> targets;
+            for (const char* outputName : outputNames) {
+                writers.push_back(std::make_unique<ppmStreamWriter>(outputName, imageWidth, imageHeight, outputFormat, tonemap));
+                targets.push_back(writers.back().get());
+            }
+            queuedSink sink(outputs, imageWidth, targets);
+            renderStats stats = renderStreaming(world, cam, settings, streamRows, sink);
+            std::clog << "\rDone.                 \n";
+            stats.print(std::clog);
+            // The writers are still finished after a failed band so their files are closed
+            bool written = outputs.finish();
+            if (!written)
+                std::cerr << "Could not write the scanline bands" << std::endl;
+            for (size_t i = 0; i < writers.size(); ++i) {
+                if (!writers[i]->finish()) {
+                    std::cerr << "Could not write '" << outputNames[i] << "'" << std::endl;
+                    written = false;
+                }
+                else
+                    std::cout << "Image saved as '" << outputNames[i] << "'" << std::endl;
+            }
+            return written ? 0 : 1;
         }
 
+        renderStats stats;
+        std::unique_ptr<renderCheckpoint> checkpoint;
+        if (checkpointName) {
+            // Finished scanlines are saved as the render goes; a resumed render only traces the rest
+            checkpoint = std::make_unique<renderCheckpoint>(checkpointName, renderSetupHash(world, cam, settings), imageWidth, imageHeight, checkpointInterval);
+            if (resume)
+                std::clog << "Resumed " << checkpoint->resume(cam) << " of " << imageHeight << " scanlines from '" << checkpointName << "'" << std::endl;
+            stats = renderResuming(world, cam, settings, [&](int first, int last) { return checkpoint->finished(first, last); },
+                [&](int first, int last) { checkpoint->rowsDone(first, last, cam); });
+        }
+        else if (progressive) {
+            // Every coarser pass goes out as a preview into the same files, overwritten by the next
+            auto start = std::chrono::steady_clock::now();
+            stats = renderProgressive(world, cam, settings, [&](int step) {
+                std::clog << "\rPass 1/" << step << " after " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e3 << " ms" << std::endl;
+                if (step == 1) return;
+                std::vector<std::vector<colorRGB>> preview = cam.pixels;
+                outputs.submitImage(std::move(preview), [&](const std::vector<std::vector<colorRGB>>& pixels) {
+                    bool written = true;
+                    for (const char* outputName : outputNames)
+                        written = saveImage(pixels, outputName, outputFormat, tonemap) && written;
+                    return written;
+                });
+            });
+        }
+        else
+            stats = render(world, cam, settings);
         std::clog << "\rDone.                 \n";
-        
-        saveAsPPM(cam.pixels, imageWidth, imageHeight, "circle_red.ppm");
-
+        stats.print(std::clog);
+        if (checkpoint)
+            std::clog << "Checkpoints: " << checkpoint->saveCount() << " written in " << checkpoint->saveSeconds() * 1e3 << " ms" << std::endl;
+        outputs.submitImage(std::move(cam.pixels), [&](const std::vector<std::vector<colorRGB>>& pixels) {
+            bool written = true;
+            for (const char* outputName : outputNames)
+                written = saveImage(pixels, outputName, outputFormat, tonemap) && written;
+            return written;
+        });
+        if (!outputs.finish())
+            return 1;
+        if (checkpoint)
+            checkpoint->remove();
         return 0;
     }
@@ -0,0 +1,40 @@
+#include "arena.h"
+#include <cstdint>
+
+namespace {
+	size_t alignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+void arena::reserve(size_t bytes) {
+	if (bytes <= size) return;
+	block.reset(new unsigned char[bytes]);
+	size = bytes;
+	offset = 0;
+}
+
+void* arena::allocate(size_t bytes, size_t alignment) {
+	uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+	size_t start = alignUp(base + offset, alignment) - base;
+	if (block && start + bytes <= size) {
+		offset = start + bytes;
+		return block.get() + start;
+	}
+
+	// Out of space: fall back to a dedicated block until the next reset
+	overflow.emplace_back(new unsigned char[bytes + alignment]);
+	overflowBytes += bytes + alignment;
+	uintptr_t spill = reinterpret_cast<uintptr_t>(overflow.back().get());
+	return reinterpret_cast<void*>(alignUp(spill, alignment));
+}
+
+void arena::reset() {
+	if (!overflow.empty()) {
+		size_t needed = size + overflowBytes;
+		overflow.clear();
+		overflowBytes = 0;
+		reserve(needed);
+	}
+	offset = 0;
+}
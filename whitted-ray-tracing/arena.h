@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Bump allocator for per-thread transient data such as scratch rows and ray-tree nodes. Nothing is freed
+// individually; reset() releases everything at once at the end of a pixel or tile. Size it with reserve()
+// before rendering so the render loop never reaches the general heap
+class arena
+{
+public:
+	// Makes sure at least bytes are available after the next reset()
+	void reserve(size_t bytes);
+
+	void* allocate(size_t bytes, size_t alignment);
+
+	// Default-constructed array of count objects. Destructors are never run, so T must not own resources
+	template<typename T>
+	T* allocate(size_t count) {
+		T* items = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+		for (size_t i = 0; i < count; ++i)
+			new (items + i) T();
+		return items;
+	}
+
+	// Releases every allocation. If earlier allocations spilled into extra blocks, they are merged into one
+	// block big enough for all of them, so the same workload fits without spilling next time
+	void reset();
+
+	size_t capacity() const { return size; }
+	size_t used() const { return offset; }
+
+private:
+	std::unique_ptr<unsigned char[]> block;
+	size_t size = 0;
+	size_t offset = 0;
+
+	// Blocks allocated when the main block ran out, and the bytes taken from them
+	std::vector<std::unique_ptr<unsigned char[]>> overflow;
+	size_t overflowBytes = 0;
+};
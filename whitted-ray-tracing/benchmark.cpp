@@ -0,0 +1,621 @@
+#include "benchmark.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+#include "camera.h"
+#include "hdrOutput.h"
+#include "imageOutput.h"
+#include "mappedImage.h"
+#include "outputQueue.h"
+#include "pngEncoder.h"
+#include "qoiEncoder.h"
+#include "parallel.h"
+#include "renderer.h"
+#include "scenes.h"
+
+namespace {
+	double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Traces one primary ray per pixel, then a shadow ray from every hit towards lightPosition.
+	// Returns the hit and occlusion counts so runs over different accelerators can be checked against each other
+	void traceFrame(const scene& world, const camera& cam, int width, int height, const glm::vec3& lightPosition,
+		double& closestSeconds, double& anySeconds, long long& hits, long long& occluded) {
+		std::vector<HitInfo> hitInfos(static_cast<size_t>(width) * height);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		parallelFor(height, [&](int i, int) {
+			for (int j = 0; j < width; ++j) {
+				float ndcX = (2.0f * j / width) - 1.0f;
+				float ndcY = 1.0f - (2.0f * i / height);
+				world.intersect(cam.getRay(ndcX, ndcY), hitInfos[static_cast<size_t>(i) * width + j]);
+			}
+		});
+		closestSeconds = secondsSince(start);
+
+		std::vector<char> blocked(hitInfos.size(), 0);
+		start = std::chrono::high_resolution_clock::now();
+		parallelFor(height, [&](int i, int) {
+			for (int j = 0; j < width; ++j) {
+				size_t index = static_cast<size_t>(i) * width + j;
+				const HitInfo& hit = hitInfos[index];
+				if (!hit.hit) continue;
+				surfaceInteraction surface;
+				world.computeSurfaceInteraction(cam.getRay((2.0f * j / width) - 1.0f, 1.0f - (2.0f * i / height)), hit, surface);
+				glm::vec3 toLight = lightPosition - surface.point;
+				float distance = glm::length(toLight);
+				ray shadowRay(surface.point + rayEpsilon * surface.normal, toLight / distance, rayEpsilon, distance);
+				blocked[index] = world.occluded(shadowRay) ? 1 : 0;
+			}
+		});
+		anySeconds = secondsSince(start);
+
+		hits = occluded = 0;
+		for (size_t i = 0; i < hitInfos.size(); ++i) {
+			hits += hitInfos[i].hit ? 1 : 0;
+			occluded += blocked[i];
+		}
+	}
+
+	// RMS and largest per-channel difference between two frames, in 8-bit display levels after clamping
+	void imageError(const std::vector<std::vector<colorRGB>>& image, const std::vector<std::vector<colorRGB>>& reference,
+		double& rmsError, double& maxError) {
+		double sum = 0.0;
+		long long count = 0;
+		maxError = 0.0;
+		for (size_t i = 0; i < image.size(); ++i) {
+			for (size_t j = 0; j < image[i].size(); ++j) {
+				const colorRGB& a = image[i][j];
+				const colorRGB& b = reference[i][j];
+				const double diff[3] = { glm::clamp(a.r, 0.0, 1.0) - glm::clamp(b.r, 0.0, 1.0),
+					glm::clamp(a.g, 0.0, 1.0) - glm::clamp(b.g, 0.0, 1.0), glm::clamp(a.b, 0.0, 1.0) - glm::clamp(b.b, 0.0, 1.0) };
+				for (double d : diff) {
+					sum += d * d;
+					maxError = glm::max(maxError, glm::abs(d) * 255.0);
+				}
+				count += 3;
+			}
+		}
+		rmsError = count > 0 ? std::sqrt(sum / count) * 255.0 : 0.0;
+	}
+
+	// Smooth gradients with some overexposed pixels, standing in for a rendered frame
+	std::vector<std::vector<colorRGB>> testImage(int width, int height) {
+		std::vector<std::vector<colorRGB>> pixels(height, std::vector<colorRGB>(width));
+		parallelFor(height, [&](int i, int) {
+			for (int j = 0; j < width; ++j)
+				pixels[i][j] = colorRGB(1.2 * j / width, static_cast<double>(i) / height, 0.5 + 0.5 * std::sin(0.01 * (i + j)));
+		});
+		return pixels;
+	}
+
+	long long fileSize(const char* filename) {
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		return file ? static_cast<long long>(file.tellg()) : 0;
+	}
+
+	void benchmarkScene(const char* sceneName, scene& world, const sceneView& view, int width, int height) {
+		camera cam(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::vec3 lightPosition = view.position + glm::vec3(0.0f, 20.0f, 0.0f);
+		double rays = static_cast<double>(width) * height;
+
+		std::printf("\n%s: %d objects\n", sceneName, world.objectCount());
+		std::printf("  %-8s %12s %12s %14s %14s %10s %10s\n", "accel", "build (ms)", "memory (KB)", "closest Mray/s", "any Mray/s", "hits", "occluded");
+		const acceleratorType types[] = { acceleratorType::bvh, acceleratorType::grid, acceleratorType::kdtree };
+		for (acceleratorType type : types) {
+			auto start = std::chrono::high_resolution_clock::now();
+			world.setAccelerator(type);
+			double buildSeconds = secondsSince(start);
+
+			double closestSeconds, anySeconds;
+			long long hits, occluded;
+			traceFrame(world, cam, width, height, lightPosition, closestSeconds, anySeconds, hits, occluded);
+			std::printf("  %-8s %12.2f %12zu %14.2f %14.2f %10lld %10lld\n", world.accel->name(), buildSeconds * 1e3,
+				world.accel->memoryUsage() / 1024, rays / closestSeconds * 1e-6, hits / anySeconds * 1e-6, hits, occluded);
+		}
+	}
+}
+
+void runAcceleratorBenchmark(int width, int height) {
+	std::printf("Accelerator benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	{
+		scene world;
+		sceneView view = buildParticleScene(world, 200000);
+		benchmarkScene("particles", world, view, width, height);
+	}
+	{
+		scene world;
+		sceneView view = buildArchitecturalScene(world, 12, 24);
+		benchmarkScene("architecture", world, view, width, height);
+	}
+}
+
+void runRefitBenchmark(int frames) {
+	std::printf("BVH refit benchmark, %d frames, %d threads\n", frames, workerCount());
+	// Update is the mean over all frames, refit the mean over the frames that did not rebuild
+	std::printf("  %-20s %9s %11s %12s %11s %12s %10s %11s\n", "scene", "objects", "build (ms)", "update (us)", "refit (us)", "worst (us)", "rebuilds", "hits match");
+	for (int sceneIndex = 0; sceneIndex < 4; ++sceneIndex) {
+		scene world;
+		const int particleCounts[] = { 1000, 10000, 100000 };
+		sceneView view = sceneIndex < 3 ? buildParticleScene(world, particleCounts[sceneIndex]) : buildArchitecturalScene(world, 12, 24);
+		char name[32];
+		std::snprintf(name, sizeof(name), sceneIndex < 3 ? "particles" : "architecture (inst.)");
+
+		auto start = std::chrono::high_resolution_clock::now();
+		world.setAccelerator(acceleratorType::bvh);
+		double buildSeconds = secondsSince(start);
+
+		// Every object drifts along its own direction, slowly enough that the tree degrades over many frames
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> drift(-0.02f, 0.02f);
+		std::vector<glm::vec3> velocities(world.objectCount());
+		for (glm::vec3& v : velocities)
+			v = glm::vec3(drift(rng), drift(rng), drift(rng));
+		std::vector<glm::mat4x3> placements;
+		for (const instance& inst : world.instances)
+			placements.push_back(inst.objectToWorld);
+
+		double updateSeconds = 0.0, refitSeconds = 0.0, worstSeconds = 0.0;
+		int rebuilds = 0;
+		for (int frame = 1; frame <= frames; ++frame) {
+			for (size_t i = 0; i < world.spheres.size(); ++i)
+				world.spheres[i].center += velocities[i];
+			for (size_t i = 0; i < world.instances.size(); ++i) {
+				glm::mat4x3 moved = placements[i];
+				moved[3] += velocities[world.spheres.size() + i] * static_cast<float>(frame);
+				world.instances[i].setTransform(moved);
+			}
+			start = std::chrono::high_resolution_clock::now();
+			world.update();
+			double seconds = secondsSince(start);
+			updateSeconds += seconds;
+			worstSeconds = glm::max(worstSeconds, seconds);
+			rebuilds += world.lastUpdateRebuilt ? 1 : 0;
+			refitSeconds += world.lastUpdateRebuilt ? 0.0 : seconds;
+		}
+
+		// The refit tree has to find the same closest hits as one built for the final positions
+		camera cam(128, 128, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f), false);
+		std::vector<HitInfo> updated(128 * 128), rebuilt(128 * 128);
+		for (int pass = 0; pass < 2; ++pass) {
+			if (pass == 1) world.setAccelerator(acceleratorType::bvh);
+			std::vector<HitInfo>& hits = pass == 0 ? updated : rebuilt;
+			for (int i = 0; i < 128 * 128; ++i)
+				world.intersect(cam.getRay((i % 128 + 0.5f) / 64.0f - 1.0f, 1.0f - (i / 128 + 0.5f) / 64.0f), hits[i]);
+		}
+		bool match = true;
+		for (int i = 0; i < 128 * 128; ++i)
+			match = match && updated[i].hit == rebuilt[i].hit && (!updated[i].hit || (updated[i].object == rebuilt[i].object && updated[i].t == rebuilt[i].t));
+
+		std::printf("  %-20s %9d %11.2f %12.1f %11.1f %12.1f %6d/%-3d %11s\n", name, world.objectCount(), buildSeconds * 1e3,
+			updateSeconds / frames * 1e6, refitSeconds / glm::max(frames - rebuilds, 1) * 1e6, worstSeconds * 1e6, rebuilds, frames, match ? "yes" : "no");
+	}
+}
+
+void runShadowCacheBenchmark(int width, int height) {
+	std::printf("Shadow occluder cache benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	std::printf("  %-14s %-6s %10s %12s %14s\n", "scene", "cache", "time (ms)", "shadow rays", "cache hits");
+	for (int sceneIndex = 0; sceneIndex < 2; ++sceneIndex) {
+		scene world;
+		sceneView view = sceneIndex == 0 ? buildParticleScene(world, 200000) : buildArchitecturalScene(world, 12, 24);
+		camera cam(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+		for (int cache = 0; cache < 2; ++cache) {
+			renderSettings settings;
+			settings.occluderCache = cache == 1;
+			auto start = std::chrono::high_resolution_clock::now();
+			renderStats stats = render(world, cam, settings);
+			double seconds = secondsSince(start);
+
+			double hitRate = stats.occluderCacheTests > 0 ? 100.0 * stats.occluderCacheHits / stats.occluderCacheTests : 0.0;
+			std::printf("  %-14s %-6s %10.2f %12lld %13.1f%%\n", sceneIndex == 0 ? "particles" : "architecture",
+				cache ? "on" : "off", seconds * 1e3, stats.shadowRays, hitRate);
+		}
+	}
+}
+
+void runPruningBenchmark(int width, int height) {
+	std::printf("Ray tree pruning benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	scene world;
+	sceneView view = buildWhittedScene(world);
+	camera reference(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+	camera cam = reference;
+
+	std::printf("  %-6s %-10s %10s %14s %12s %10s %10s\n", "depth", "threshold", "time (ms)", "secondary", "culled", "RMS error", "max error");
+	const double thresholds[] = { 0.0, 0.001, 0.003, 0.01, 0.03, 0.1 };
+	for (double threshold : thresholds) {
+		renderSettings settings;
+		settings.maxDepth = maxTraceDepth;
+		settings.minContribution = threshold;
+		camera& target = threshold == 0.0 ? reference : cam;
+		auto start = std::chrono::high_resolution_clock::now();
+		renderStats stats = render(world, target, settings);
+		double seconds = secondsSince(start);
+
+		double rmsError, maxError;
+		imageError(target.pixels, reference.pixels, rmsError, maxError);
+		std::printf("  %-6d %-10g %10.2f %14lld %12lld %10.4f %10.2f\n", settings.maxDepth, threshold, seconds * 1e3,
+			stats.reflectionRays + stats.refractionRays, stats.culledRays, rmsError, maxError);
+	}
+
+	// Fixed depth limits without pruning, for comparison
+	for (int depth = 2; depth <= 8; depth += 3) {
+		renderSettings settings;
+		settings.maxDepth = depth;
+		settings.minContribution = 0.0;
+		auto start = std::chrono::high_resolution_clock::now();
+		renderStats stats = render(world, cam, settings);
+		double seconds = secondsSince(start);
+
+		double rmsError, maxError;
+		imageError(cam.pixels, reference.pixels, rmsError, maxError);
+		std::printf("  %-6d %-10g %10.2f %14lld %12lld %10.4f %10.2f\n", depth, 0.0, seconds * 1e3,
+			stats.reflectionRays + stats.refractionRays, stats.culledRays, rmsError, maxError);
+	}
+}
+
+void runAntialiasBenchmark(int width, int height) {
+	std::printf("Antialiasing benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	scene world;
+	sceneView view = buildWhittedScene(world);
+	camera reference(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+	camera cam = reference;
+
+	renderSettings referenceSettings;
+	referenceSettings.antialiasing = antialiasMode::uniform;
+	referenceSettings.samplesPerAxis = 12;
+	render(world, reference, referenceSettings);
+
+	std::printf("  %-9s %-12s %10s %10s %10s %10s\n", "mode", "parameter", "rays/px", "time (ms)", "RMS error", "max error");
+	auto run = [&](const renderSettings& settings, const char* mode, double parameter) {
+		auto start = std::chrono::high_resolution_clock::now();
+		renderStats stats = render(world, cam, settings);
+		double seconds = secondsSince(start);
+
+		double rmsError, maxError;
+		imageError(cam.pixels, reference.pixels, rmsError, maxError);
+		std::printf("  %-9s %-12g %10.2f %10.2f %10.4f %10.2f\n", mode, parameter,
+			static_cast<double>(stats.primaryRays) / (static_cast<double>(width) * height), seconds * 1e3, rmsError, maxError);
+	};
+
+	for (int n = 1; n <= 4; ++n) {
+		renderSettings settings;
+		settings.antialiasing = antialiasMode::uniform;
+		settings.samplesPerAxis = n;
+		run(settings, "uniform", n * n);
+	}
+	const double thresholds[] = { 0.2, 0.1, 0.05, 0.02 };
+	for (double threshold : thresholds) {
+		renderSettings settings;
+		settings.antialiasing = antialiasMode::adaptive;
+		settings.adaptiveThreshold = threshold;
+		run(settings, "adaptive", threshold);
+	}
+}
+
+void runShadingBenchmark(int width, int height) {
+	std::printf("Shading kernel benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	std::printf("  %-14s %14s %16s %10s\n", "scene", "generic (ms)", "specialized (ms)", "max error");
+	for (int sceneIndex = 0; sceneIndex < 3; ++sceneIndex) {
+		scene world;
+		const char* name = sceneIndex == 0 ? "whitted" : sceneIndex == 1 ? "architecture" : "particles";
+		sceneView view = sceneIndex == 0 ? buildWhittedScene(world)
+			: sceneIndex == 1 ? buildArchitecturalScene(world, 12, 24) : buildParticleScene(world, 200000);
+		camera generic(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+		camera specialized = generic;
+
+		// Best of a few runs each, alternating, to keep the comparison fair on a noisy machine
+		double seconds[2] = { 1e30, 1e30 };
+		for (int run = 0; run < 3; ++run) {
+			for (int mode = 0; mode < 2; ++mode) {
+				renderSettings settings;
+				settings.specializedShading = mode == 1;
+				auto start = std::chrono::high_resolution_clock::now();
+				render(world, mode == 1 ? specialized : generic, settings);
+				seconds[mode] = glm::min(seconds[mode], secondsSince(start));
+			}
+		}
+
+		double rmsError, maxError;
+		imageError(specialized.pixels, generic.pixels, rmsError, maxError);
+		std::printf("  %-14s %14.2f %16.2f %10.2f\n", name, seconds[0] * 1e3, seconds[1] * 1e3, maxError);
+	}
+}
+
+void runLightCullingBenchmark(int width, int height) {
+	scene world;
+	buildArchitecturalScene(world, 6, 8, true);
+	// On the ground floor, looking down the doorways of the first row of rooms
+	camera reference(width, height, glm::vec3(-15.0f, 1.5f, -15.0f), glm::vec3(16.0f, 1.2f, -14.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	camera cam = reference;
+
+	std::printf("Light culling benchmark at %dx%d, %d threads, %zu lights\n", width, height, workerCount(), world.lights.size());
+	std::printf("  %-10s %-10s %10s %14s %14s %10s %10s\n", "lights", "threshold", "time (ms)", "shadow/hit", "culled/hit", "RMS error", "max error");
+	const float thresholds[] = { -1.0f, 0.0f, 0.005f, 0.01f, 0.02f, 0.05f };
+	for (float threshold : thresholds) {
+		renderSettings settings;
+		settings.lightTree = threshold >= 0.0f;
+		settings.minLightContribution = threshold;
+		camera& target = settings.lightTree ? cam : reference;
+		auto start = std::chrono::high_resolution_clock::now();
+		renderStats stats = render(world, target, settings);
+		double seconds = secondsSince(start);
+
+		double rmsError, maxError;
+		imageError(target.pixels, reference.pixels, rmsError, maxError);
+		double hits = static_cast<double>(glm::max(stats.shadedHits, 1LL));
+		std::printf("  %-10s %-10g %10.2f %14.2f %14.2f %10.4f %10.2f\n", settings.lightTree ? "tree" : "all", glm::max(threshold, 0.0f),
+			seconds * 1e3, stats.shadowRays / hits, stats.culledLights / hits, rmsError, maxError);
+	}
+}
+
+void runImageWriteBenchmark(int maxSize) {
+	const char* filename = "benchmark_output.ppm";
+	const int sizes[] = { 600, 1024, 2048, 4096, 8192, 16384 };
+	// Text output is two orders of magnitude slower, so it is only timed up to this size
+	const int maxASCIISize = 4096;
+
+	std::printf("PPM write benchmark up to %dx%d\n", maxSize, maxSize);
+	std::printf("  %-12s %-7s %12s %12s %10s\n", "size", "format", "file (MB)", "time (ms)", "MB/s");
+	for (int size : sizes) {
+		if (size > maxSize) break;
+		std::vector<std::vector<colorRGB>> pixels = testImage(size, size);
+		char sizeName[32];
+		std::snprintf(sizeName, sizeof(sizeName), "%dx%d", size, size);
+
+		// The tonemapping pass on its own, which every format runs first
+		std::vector<unsigned char> levels(static_cast<size_t>(size) * size * 3);
+		auto start = std::chrono::high_resolution_clock::now();
+		quantizeImage(pixels, tonemapSettings(), levels.data());
+		double quantizeSeconds = secondsSince(start);
+		std::printf("  %-12s %-7s %12s %12.2f %10.1f\n", sizeName, "tonemap", "", quantizeSeconds * 1e3, levels.size() / 1e6 / quantizeSeconds);
+
+		for (ppmFormat format : { ppmFormat::ascii, ppmFormat::binary }) {
+			if (format == ppmFormat::ascii && size > maxASCIISize) continue;
+			start = std::chrono::high_resolution_clock::now();
+			bool written = writePPM(filename, pixels, format);
+			double seconds = secondsSince(start);
+			double megabytes = fileSize(filename) / 1e6;
+			std::printf("  %-12s %-7s %12.1f %12.2f %10.1f%s\n", sizeName, format == ppmFormat::binary ? "P6" : "P3",
+				megabytes, seconds * 1e3, megabytes / seconds, written ? "" : "  (write failed)");
+		}
+	}
+	std::remove(filename);
+}
+
+void runStreamingBenchmark(int width, int height) {
+	scene world;
+	sceneView view = buildWhittedScene(world);
+	renderSettings settings;
+	const char* referenceName = "benchmark_reference.ppm";
+	const char* streamedName = "benchmark_streamed.ppm";
+
+	std::printf("Streaming output benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	std::printf("  %-12s %12s %16s %10s\n", "window", "time (ms)", "buffers (MB)", "identical");
+
+	auto start = std::chrono::high_resolution_clock::now();
+	camera full(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+	render(world, full, settings);
+	writePPM(referenceName, full.pixels, ppmFormat::binary);
+	double seconds = secondsSince(start);
+	const double bytesPerPixel = sizeof(colorRGB) + 3;
+	std::printf("  %-12s %12.2f %16.2f %10s\n", "full frame", seconds * 1e3, bytesPerPixel * width * height / 1e6, "-");
+	std::ifstream referenceFile(referenceName, std::ios::binary);
+	std::vector<char> reference((std::istreambuf_iterator<char>(referenceFile)), std::istreambuf_iterator<char>());
+
+	const int windows[] = { 1, 16, 64, 256 };
+	for (int windowRows : windows) {
+		start = std::chrono::high_resolution_clock::now();
+		camera cam(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f), false);
+		ppmStreamWriter writer(streamedName, width, height, ppmFormat::binary);
+		renderStreaming(world, cam, settings, windowRows, writer);
+		bool written = writer.finish();
+		seconds = secondsSince(start);
+
+		std::ifstream streamedFile(streamedName, std::ios::binary);
+		std::vector<char> streamed((std::istreambuf_iterator<char>(streamedFile)), std::istreambuf_iterator<char>());
+		char name[32];
+		std::snprintf(name, sizeof(name), "%d rows", windowRows);
+		std::printf("  %-12s %12.2f %16.2f %10s\n", name, seconds * 1e3, bytesPerPixel * width * glm::min(windowRows, height) / 1e6,
+			written && streamed == reference ? "yes" : "no");
+	}
+	std::remove(referenceName);
+	std::remove(streamedName);
+}
+
+void runMappedOutputBenchmark(int width, int height) {
+	scene world;
+	sceneView view = buildWhittedScene(world);
+	renderSettings settings;
+	const char* names[] = { "benchmark_buffered.ppm", "benchmark_streamed.ppm", "benchmark_mapped.ppm" };
+	const char* labels[] = { "buffered", "streamed", "mapped" };
+
+	std::printf("Output path benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	std::printf("  %-10s %12s %18s %10s\n", "path", "total (ms)", "after render (ms)", "identical");
+	std::vector<char> reference;
+	for (int path = 0; path < 3; ++path) {
+		auto start = std::chrono::high_resolution_clock::now();
+		camera cam(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f), path == 0);
+		bool written;
+		double renderSeconds;
+		if (path == 0) {
+			render(world, cam, settings);
+			renderSeconds = secondsSince(start);
+			written = writePPM(names[path], cam.pixels, ppmFormat::binary);
+		}
+		else if (path == 1) {
+			ppmStreamWriter writer(names[path], width, height, ppmFormat::binary);
+			renderStreaming(world, cam, settings, 64, writer);
+			renderSeconds = secondsSince(start);
+			written = writer.finish();
+		}
+		else {
+			mappedPPM image;
+			written = image.create(names[path], width, height);
+			tonemapSettings tonemap;
+			renderScanlines(world, cam, settings, [&](int y, const colorRGB* pixels) {
+				quantizeRow(pixels, width, tonemap, image.row(y));
+			});
+			renderSeconds = secondsSince(start);
+			written = image.close() && written;
+		}
+		double seconds = secondsSince(start);
+
+		std::ifstream file(names[path], std::ios::binary);
+		std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (path == 0) reference = bytes;
+		std::printf("  %-10s %12.2f %18.2f %10s\n", labels[path], seconds * 1e3, (seconds - renderSeconds) * 1e3,
+			!written ? "failed" : path == 0 ? "-" : bytes == reference ? "yes" : "no");
+		std::remove(names[path]);
+	}
+}
+
+void runCompressionBenchmark(int width, int height) {
+	std::printf("Compressed output benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	std::printf("  %-15s %-18s %12s %10s %12s %8s\n", "scene", "encoder", "time (ms)", "MB/s", "size (KB)", "ratio");
+	for (int sceneIndex = 0; sceneIndex < 2; ++sceneIndex) {
+		scene world;
+		sceneView view = sceneIndex == 0 ? buildWhittedScene(world) : buildArchitecturalScene(world, 6, 8);
+		camera cam(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+		render(world, cam, renderSettings());
+		std::vector<unsigned char> levels(static_cast<size_t>(width) * height * 3);
+		quantizeImage(cam.pixels, tonemapSettings(), levels.data());
+		double rawBytes = static_cast<double>(levels.size());
+
+		const char* encoders[] = { "QOI", "PNG, one chunk", "PNG, 256 KB chunks", "PNG, 64 KB chunks" };
+		for (int encoder = 0; encoder < 4; ++encoder) {
+			std::vector<unsigned char> encoded;
+			auto start = std::chrono::high_resolution_clock::now();
+			if (encoder == 0)
+				encodeQOI(levels.data(), width, height, true, encoded);
+			else {
+				const size_t chunkBytes[] = { 0, levels.size() + height, 256 * 1024, 64 * 1024 };
+				encodePNG(levels.data(), width, height, true, encoded, chunkBytes[encoder]);
+			}
+			double seconds = secondsSince(start);
+			std::printf("  %-15s %-18s %12.2f %10.1f %12.1f %8.2f\n", sceneIndex == 0 ? "whitted" : "architectural", encoders[encoder],
+				seconds * 1e3, rawBytes / 1e6 / seconds, encoded.size() / 1024.0, rawBytes / encoded.size());
+		}
+	}
+}
+
+void runHDROutputBenchmark(int width, int height) {
+	std::printf("HDR output benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	scene world;
+	sceneView view = buildWhittedScene(world);
+	camera cam(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+	render(world, cam, renderSettings());
+
+	std::printf("  %-22s %12s %12s\n", "format", "time (ms)", "size (KB)");
+	const char* names[] = { "P6 (8-bit, tonemapped)", "Radiance HDR (RLE)", "EXR (half float)" };
+	const char* files[] = { "bench_hdr.ppm", "bench_hdr.hdr", "bench_hdr.exr" };
+	for (int format = 0; format < 3; ++format) {
+		auto start = std::chrono::high_resolution_clock::now();
+		bool written = format == 0 ? writePPM(files[format], cam.pixels, ppmFormat::binary)
+			: format == 1 ? writeRadianceHDR(files[format], cam.pixels)
+			: writeEXR(files[format], cam.pixels);
+		double seconds = secondsSince(start);
+		std::printf("  %-22s %12.2f %12.1f%s\n", names[format], seconds * 1e3, fileSize(files[format]) / 1024.0, written ? "" : "  (write failed)");
+		std::remove(files[format]);
+	}
+
+	// Conversion alone, over values spanning the half range including subnormals
+	std::vector<float> values(static_cast<size_t>(width) * height * 3);
+	for (size_t i = 0; i < values.size(); ++i)
+		values[i] = std::ldexp(static_cast<float>(i % 997) / 997.0f, static_cast<int>(i % 40) - 24);
+	std::vector<uint16_t> halves(values.size());
+	auto start = std::chrono::high_resolution_clock::now();
+	floatsToHalves(values.data(), values.size(), halves.data());
+	double seconds = secondsSince(start);
+	std::printf("  float to half: %.2f ms, %.0f Mfloats/s\n", seconds * 1e3, values.size() / 1e6 / seconds);
+}
+
+void runOutputQueueBenchmark(int width, int height, int frames) {
+	scene world;
+	sceneView view = buildWhittedScene(world);
+	renderSettings settings;
+	std::printf("Output thread benchmark, %d frames at %dx%d, 3 outputs each, %d render threads\n", frames, width, height, workerCount());
+	std::printf("  %-10s %12s %18s %14s %14s\n", "outputs", "total (ms)", "after render (ms)", "blocked (ms)", "output (ms)");
+
+	auto writeFrame = [](int frame, const std::vector<std::vector<colorRGB>>& pixels) {
+		char name[64];
+		bool written = true;
+		const char* extensions[] = { "png", "hdr", "exr" };
+		for (int output = 0; output < 3; ++output) {
+			std::snprintf(name, sizeof(name), "benchmark_frame%d.%s", frame, extensions[output]);
+			written = (output == 0 ? writePNG(name, pixels) : output == 1 ? writeRadianceHDR(name, pixels) : writeEXR(name, pixels)) && written;
+			std::remove(name);
+		}
+		return written;
+	};
+
+	for (int queued = 0; queued < 2; ++queued) {
+		auto start = std::chrono::high_resolution_clock::now();
+		double renderEnd = 0.0, outputSeconds = 0.0, blockedSeconds = 0.0;
+		bool written = true;
+		outputQueue queue;
+		for (int frame = 0; frame < frames; ++frame) {
+			glm::vec3 position = view.position + glm::vec3(0.05f * frame, 0.0f, 0.0f);
+			camera cam(width, height, position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+			render(world, cam, settings);
+			renderEnd = secondsSince(start);
+			if (queued)
+				queue.submitImage(std::move(cam.pixels), [frame, writeFrame](const std::vector<std::vector<colorRGB>>& pixels) { return writeFrame(frame, pixels); });
+			else {
+				auto outputStart = std::chrono::high_resolution_clock::now();
+				written = writeFrame(frame, cam.pixels) && written;
+				outputSeconds += secondsSince(outputStart);
+			}
+		}
+		written = queue.finish() && written;
+		double seconds = secondsSince(start);
+		if (queued) {
+			outputSeconds = queue.busySeconds();
+			blockedSeconds = queue.blockedSeconds();
+		}
+		std::printf("  %-10s %12.2f %18.2f %14.2f %14.2f%s\n", queued ? "queued" : "inline", seconds * 1e3, (seconds - renderEnd) * 1e3,
+			blockedSeconds * 1e3, outputSeconds * 1e3, written ? "" : "  (write failed)");
+	}
+}
+
+void runProgressiveBenchmark(int width, int height) {
+	std::printf("Progressive rendering benchmark at %dx%d, %d threads\n", width, height, workerCount());
+	// Errors are in 8-bit levels; shading batches group rays differently, so they may differ in the last bits
+	std::printf("  %-13s %-9s %11s %9s %9s %9s %9s %10s %14s %10s\n", "scene", "sampling", "direct (ms)", "1/8 (ms)",
+		"1/4 (ms)", "1/2 (ms)", "full (ms)", "overhead", "extra rays", "max error");
+	for (int sceneIndex = 0; sceneIndex < 2; ++sceneIndex) {
+		scene world;
+		sceneView view = sceneIndex == 0 ? buildWhittedScene(world) : buildArchitecturalScene(world, 12, 24);
+		for (int mode = 0; mode < 3; ++mode) {
+			renderSettings settings;
+			settings.antialiasing = mode == 0 ? antialiasMode::none : mode == 1 ? antialiasMode::uniform : antialiasMode::adaptive;
+			settings.samplesPerAxis = 2;
+			camera direct(width, height, view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+			camera progressive = direct;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			renderStats directStats = render(world, direct, settings);
+			double directSeconds = secondsSince(start);
+
+			// Pass times are cumulative: the 1/8 column is the time to the first preview
+			double passSeconds[4] = {};
+			int pass = 0;
+			start = std::chrono::high_resolution_clock::now();
+			renderStats progressiveStats = renderProgressive(world, progressive, settings, [&](int) { passSeconds[pass++] = secondsSince(start); });
+			double seconds = secondsSince(start);
+			double rmsError, maxError;
+			imageError(progressive.pixels, direct.pixels, rmsError, maxError);
+
+			const char* sampling[] = { "none", "2x2", "adaptive" };
+			std::printf("  %-13s %-9s %11.2f %9.2f %9.2f %9.2f %9.2f %9.1f%% %14lld %10.2g\n", sceneIndex == 0 ? "whitted" : "architecture",
+				sampling[mode], directSeconds * 1e3, passSeconds[0] * 1e3, passSeconds[1] * 1e3, passSeconds[2] * 1e3, passSeconds[3] * 1e3,
+				100.0 * (seconds - directSeconds) / directSeconds, progressiveStats.primaryRays - directStats.primaryRays,
+				maxError);
+		}
+	}
+}
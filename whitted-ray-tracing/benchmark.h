@@ -0,0 +1,60 @@
+#pragma once
+
+// Builds every accelerator type over each test scene and reports build time, memory and closest-hit and
+// any-hit query throughput at the given resolution
+void runAcceleratorBenchmark(int width, int height);
+
+// Moves the objects of the particle and architectural scenes a little every frame and brings the BVH up to date
+// with scene::update(). Reports the time of a full build against the mean and worst update, how many updates
+// rebuilt, and whether closest hits after the last frame match a freshly built tree
+void runRefitBenchmark(int frames);
+
+// Renders each test scene with and without the per-light occluder cache and reports shadow ray cost and hit rate
+void runShadowCacheBenchmark(int width, int height);
+
+// Renders the Whitted scene at full depth as a reference, then with increasing contribution thresholds, and
+// reports secondary ray counts, culled rays, time and the error against the reference
+void runPruningBenchmark(int width, int height);
+
+// Compares uniform and adaptive supersampling of the Whitted scene against a densely supersampled reference,
+// reporting primary rays per pixel, time and image error
+void runAntialiasBenchmark(int width, int height);
+
+// Renders each test scene with the generic shading kernel and with per-material specialized kernels and
+// reports the time of each and the largest pixel difference between them
+void runShadingBenchmark(int width, int height);
+
+// Renders the architectural scene with a light in every room, first shading every light, then picking lights
+// from the light BVH at several contribution thresholds. Reports shadow rays per hit, time and image error
+void runLightCullingBenchmark(int width, int height);
+
+// Writes synthetic square frames from 600x600 up to maxSize (at most 16384) as ASCII and binary PPM and reports
+// file size, write time and throughput, plus the time of the tonemapping pass alone. Needs about 27 bytes of memory per pixel of the largest frame
+void runImageWriteBenchmark(int maxSize);
+
+// Renders the Whitted scene into a full framebuffer and writes it as P6, then streams it to P6 through windows of
+// several heights. Reports time, the size of the pixel buffers held and whether the files match
+void runStreamingBenchmark(int width, int height);
+
+// Renders the Whitted scene to P6 three ways: into a framebuffer written with one buffered write, streamed in bands,
+// and quantized by the render threads straight into a memory-mapped file. Reports total time, the time of the
+// output step that follows rendering, and whether the files match
+void runMappedOutputBenchmark(int width, int height);
+
+// Renders the test scenes, tonemaps them and encodes the result as QOI and as PNG with the deflate done in one piece
+// and in parallel chunks. Reports encode time, throughput over the raw RGB bytes and size relative to P6
+void runCompressionBenchmark(int width, int height);
+
+// Renders the Whitted scene and writes its float framebuffer as Radiance HDR and as half-float EXR next to P6, reporting
+// write time and file size. Also times the float to half conversion alone
+void runHDROutputBenchmark(int width, int height);
+
+// Renders a short camera move over the Whitted scene and writes every frame as PNG, Radiance HDR and EXR, first
+// writing each frame before rendering the next, then handing frames to the output thread. Reports total time,
+// the time from the end of the last render to the last byte written, and how long rendering waited on the queue
+void runOutputQueueBenchmark(int width, int height, int frames);
+
+// Renders the Whitted and architectural scenes directly and progressively, without antialiasing, with 2x2 uniform
+// and with adaptive sampling. Reports the time to the first (1/8 resolution) preview and to each later pass, the
+// total against the direct render, the difference in primary rays and the largest difference between the final images
+void runProgressiveBenchmark(int width, int height);
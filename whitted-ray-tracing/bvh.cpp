@@ -0,0 +1,252 @@
+#include "bvh.h"
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include "parallel.h"
+
+namespace {
+	constexpr int binCount = 12;
+	constexpr int maxLeafSize = 4;
+	// Deepest level split further. Depth-first traversal holds at most one entry per level plus the two children
+	// of the current node, which keeps it inside bvhStackSize
+	constexpr int maxDepth = bvhStackSize - 2;
+	// Trees smaller than this are refit on the calling thread; spreading them out costs more than it saves
+	constexpr int parallelRefitNodes = 4096;
+
+	struct bin {
+		aabb bounds;
+		int count = 0;
+	};
+}
+
+void bvh::build(const std::vector<aabb>& primBounds) {
+	int primCount = static_cast<int>(primBounds.size());
+	nodes.clear();
+	primIndices.resize(primCount);
+	std::iota(primIndices.begin(), primIndices.end(), 0);
+	refitRoots.clear();
+	refitRanges.clear();
+	refitTop.clear();
+	builtCost = 0.0f;
+	if (primCount == 0) return;
+
+	std::vector<glm::vec3> centroids(primCount);
+	for (int i = 0; i < primCount; ++i)
+		centroids[i] = primBounds[i].centroid();
+
+	nodes.reserve(2 * primCount - 1);
+	bvhNode root;
+	root.leftFirst = 0;
+	root.count = primCount;
+	nodes.push_back(root);
+	subdivide(0, primBounds, centroids, 0);
+
+	planRefit();
+	builtCost = sahCost();
+}
+
+void bvh::subdivide(int nodeIndex, const std::vector<aabb>& primBounds, const std::vector<glm::vec3>& centroids, int depth) {
+	int first = nodes[nodeIndex].leftFirst;
+	int count = nodes[nodeIndex].count;
+
+	aabb bounds, centroidBounds;
+	for (int i = first; i < first + count; ++i) {
+		bounds.expand(primBounds[primIndices[i]]);
+		centroidBounds.expand(centroids[primIndices[i]]);
+	}
+	nodes[nodeIndex].bounds = bounds;
+	if (count <= 1 || depth >= maxDepth) return;
+
+	// Find the cheapest split plane among the bin boundaries of all three axes
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis) {
+		float lo = centroidBounds.min[axis];
+		float extent = centroidBounds.max[axis] - lo;
+		if (extent <= 0.0f) continue;
+
+		bin bins[binCount];
+		float scale = binCount / extent;
+		for (int i = first; i < first + count; ++i) {
+			int b = std::min(binCount - 1, static_cast<int>((centroids[primIndices[i]][axis] - lo) * scale));
+			bins[b].count++;
+			bins[b].bounds.expand(primBounds[primIndices[i]]);
+		}
+
+		float leftArea[binCount - 1], rightArea[binCount - 1];
+		int leftCount[binCount - 1], rightCount[binCount - 1];
+		aabb leftBox, rightBox;
+		int leftSum = 0, rightSum = 0;
+		for (int i = 0; i < binCount - 1; ++i) {
+			leftSum += bins[i].count;
+			leftCount[i] = leftSum;
+			leftBox.expand(bins[i].bounds);
+			leftArea[i] = leftBox.surfaceArea();
+
+			rightSum += bins[binCount - 1 - i].count;
+			rightCount[binCount - 2 - i] = rightSum;
+			rightBox.expand(bins[binCount - 1 - i].bounds);
+			rightArea[binCount - 2 - i] = rightBox.surfaceArea();
+		}
+
+		for (int i = 0; i < binCount - 1; ++i) {
+			float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	// All centroids coincide, nothing to split on
+	if (bestAxis < 0) return;
+	// Splitting is not worth it compared to intersecting every primitive in this node
+	float leafCost = count * bounds.surfaceArea();
+	if (bestCost >= leafCost && count <= maxLeafSize) return;
+
+	float lo = centroidBounds.min[bestAxis];
+	float scale = binCount / (centroidBounds.max[bestAxis] - lo);
+	int* middle = std::partition(primIndices.data() + first, primIndices.data() + first + count, [&](int prim) {
+		int b = std::min(binCount - 1, static_cast<int>((centroids[prim][bestAxis] - lo) * scale));
+		return b <= bestSplit;
+	});
+	int leftCount = static_cast<int>(middle - (primIndices.data() + first));
+	if (leftCount == 0 || leftCount == count) return;
+
+	int leftIndex = static_cast<int>(nodes.size());
+	bvhNode left, right;
+	left.leftFirst = first;
+	left.count = leftCount;
+	right.leftFirst = first + leftCount;
+	right.count = count - leftCount;
+	nodes.push_back(left);
+	nodes.push_back(right);
+
+	nodes[nodeIndex].leftFirst = leftIndex;
+	nodes[nodeIndex].count = 0;
+	subdivide(leftIndex, primBounds, centroids, depth + 1);
+	subdivide(leftIndex + 1, primBounds, centroids, depth + 1);
+
+	// Keep the larger child first. Closest-hit traversal orders children by distance anyway, but any-hit
+	// traversal simply goes left first, and the larger box is the likelier one to hold an occluder
+	if (nodes[leftIndex + 1].bounds.surfaceArea() > nodes[leftIndex].bounds.surfaceArea())
+		std::swap(nodes[leftIndex], nodes[leftIndex + 1]);
+}
+
+void bvh::planRefit() {
+	// Split the tree into a serial top part and enough independent subtrees to keep every worker busy.
+	// Children always have higher indices than their parent, so refitting refitTop in descending index
+	// order is bottom-up.
+	refitRoots.clear();
+	refitRanges.clear();
+	refitTop.clear();
+	if (static_cast<int>(nodes.size()) < parallelRefitNodes || workerCount() == 1) {
+		refitRoots.push_back(0);
+		refitRanges.push_back({ 1, static_cast<int>(nodes.size()) - 1 });
+		return;
+	}
+
+	// Expand breadth-first so the subtrees end up at similar depths
+	size_t targetRoots = 4 * static_cast<size_t>(workerCount());
+	std::vector<int> frontier;
+	std::vector<int> pending(1, 0);
+	size_t head = 0;
+	while (head < pending.size() && frontier.size() + pending.size() - head < targetRoots) {
+		int nodeIndex = pending[head++];
+		const bvhNode& node = nodes[nodeIndex];
+		if (node.isLeaf()) {
+			frontier.push_back(nodeIndex);
+			continue;
+		}
+		refitTop.push_back(nodeIndex);
+		pending.push_back(node.leftFirst);
+		pending.push_back(node.leftFirst + 1);
+	}
+	frontier.insert(frontier.end(), pending.begin() + head, pending.end());
+	refitRoots = frontier;
+	for (int root : refitRoots) {
+		const bvhNode& node = nodes[root];
+		refitRanges.push_back(node.isLeaf() ? std::make_pair(root + 1, root) : std::make_pair(node.leftFirst, lastDescendant(root)));
+	}
+	std::sort(refitTop.begin(), refitTop.end(), std::greater<int>());
+}
+
+int bvh::lastDescendant(int nodeIndex) const {
+	const bvhNode& node = nodes[nodeIndex];
+	if (node.isLeaf()) return nodeIndex;
+	return std::max(lastDescendant(node.leftFirst), lastDescendant(node.leftFirst + 1));
+}
+
+// Returns the node's share of the SAH cost
+float bvh::refitNode(int nodeIndex, const std::vector<aabb>& primBounds) {
+	bvhNode& node = nodes[nodeIndex];
+	aabb bounds;
+	if (node.isLeaf()) {
+		for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+			bounds.expand(primBounds[primIndices[i]]);
+	}
+	else {
+		bounds.expand(nodes[node.leftFirst].bounds);
+		bounds.expand(nodes[node.leftFirst + 1].bounds);
+	}
+	node.bounds = bounds;
+	return bounds.surfaceArea() * (node.isLeaf() ? static_cast<float>(node.count) : 1.0f);
+}
+
+float bvh::refitRange(int first, int last, const std::vector<aabb>& primBounds) {
+	// Children come after their parents, so sweeping backwards refits every child before its parent
+	float cost = 0.0f;
+	for (int nodeIndex = last; nodeIndex >= first; --nodeIndex)
+		cost += refitNode(nodeIndex, primBounds);
+	return cost;
+}
+
+void bvh::refit(const std::vector<aabb>& primBounds) {
+	if (nodes.empty()) return;
+
+	std::vector<float> costs(refitRoots.size());
+	auto refitSubtree = [&](int i, int) {
+		costs[i] = refitRange(refitRanges[i].first, refitRanges[i].second, primBounds) + refitNode(refitRoots[i], primBounds);
+	};
+	if (refitRoots.size() == 1)
+		refitSubtree(0, 0);
+	else
+		parallelFor(static_cast<int>(refitRoots.size()), refitSubtree);
+
+	refitCost = 0.0f;
+	for (float cost : costs)
+		refitCost += cost;
+	for (int nodeIndex : refitTop)
+		refitCost += refitNode(nodeIndex, primBounds);
+}
+
+bool bvh::update(const std::vector<aabb>& primBounds) {
+	if (nodes.empty() || primBounds.size() != primIndices.size()) {
+		build(primBounds);
+		return true;
+	}
+
+	refit(primBounds);
+	float rootArea = nodes[0].bounds.surfaceArea();
+	float cost = rootArea > 0.0f ? refitCost / rootArea : refitCost;
+	if (cost > builtCost * rebuildThreshold) {
+		build(primBounds);
+		return true;
+	}
+	return false;
+}
+
+float bvh::sahCost() const {
+	if (nodes.empty()) return 0.0f;
+
+	// Traversal and intersection steps are weighted equally; only the growth relative to the last
+	// build matters for update()
+	float cost = 0.0f;
+	for (const bvhNode& node : nodes)
+		cost += node.bounds.surfaceArea() * (node.isLeaf() ? static_cast<float>(node.count) : 1.0f);
+
+	float rootArea = nodes[0].bounds.surfaceArea();
+	return rootArea > 0.0f ? cost / rootArea : cost;
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <cassert>
+#include <cfloat>
+#include <utility>
+#include <vector>
+#include "aabb.h"
+#include "accelerator.h"
+#include "ray.h"
+
+struct bvhNode {
+	aabb bounds;
+	int leftFirst;  // Left child index for interior nodes (right child is leftFirst + 1), first entry in primIndices for leaves
+	int count;      // Number of primitives in a leaf, 0 for interior nodes
+
+	bool isLeaf() const { return count > 0; }
+};
+
+// Entries in the fixed traversal stacks of the BVH and of the trees built on it. build() stops splitting a few
+// levels short of it, so no traversal can overflow whatever the input
+constexpr int bvhStackSize = 64;
+
+// Bounding volume hierarchy over a list of primitive bounds. The tree only knows about boxes;
+// primitive tests are supplied by the caller during traversal, either through the accelerator
+// interface or inlined through the templated queries.
+class bvh : public accelerator
+{
+public:
+	const char* name() const override { return "bvh"; }
+
+	// Builds the tree from scratch using the binned surface area heuristic
+	void build(const std::vector<aabb>& primBounds) override;
+
+	// Recomputes node bounds bottom-up after primitives moved, keeping the topology, in one backwards sweep over
+	// the nodes that also sums the SAH cost. Independent subtrees are refit in parallel.
+	void refit(const std::vector<aabb>& primBounds);
+
+	// Refits, then rebuilds if the SAH cost grew past rebuildThreshold times the cost of the last
+	// build. Returns true if the tree was rebuilt.
+	bool update(const std::vector<aabb>& primBounds) override;
+
+	// Expected traversal cost of the current tree, normalized by the root surface area
+	float sahCost() const;
+
+	// Calls intersectPrimitive(index, tMax) for every primitive whose leaf the ray reaches, nearest
+	// leaves first. The callback returns true on a hit and shrinks tMax to the hit distance.
+	template <typename F>
+	bool intersect(const ray& r, float& tMax, F&& intersectPrimitive) const;
+
+	// Calls occludedPrimitive(index) for primitives along the ray until one returns true. Children are
+	// visited larger first rather than nearest first, which finds some occluder sooner on average
+	template <typename F>
+	bool occluded(const ray& r, float tMax, F&& occludedPrimitive) const;
+
+	bool intersectClosest(const ray& r, float& tMax, const primitiveIntersector& prims) const override {
+		return intersect(r, tMax, [&](int index, float& t) { return prims.intersect(index, r, t); });
+	}
+
+	bool intersectAny(const ray& r, float tMax, const primitiveIntersector& prims) const override {
+		return occluded(r, tMax, [&](int index) { return prims.occluded(index, r, tMax); });
+	}
+
+	size_t memoryUsage() const override { return nodes.capacity() * sizeof(bvhNode) + primIndices.capacity() * sizeof(int); }
+
+	bool empty() const { return nodes.empty(); }
+
+	std::vector<bvhNode> nodes;
+	std::vector<int> primIndices;
+
+	// Allowed SAH cost growth from refits before update() falls back to a full rebuild
+	float rebuildThreshold = 1.3f;
+
+private:
+	void subdivide(int nodeIndex, const std::vector<aabb>& primBounds, const std::vector<glm::vec3>& centroids, int depth);
+	float refitNode(int nodeIndex, const std::vector<aabb>& primBounds);
+	float refitRange(int first, int last, const std::vector<aabb>& primBounds);
+	int lastDescendant(int nodeIndex) const;
+	void planRefit();
+
+	// Subtrees refit in parallel. The descendants of a node occupy one contiguous range of nodes, after the node
+	std::vector<int> refitRoots;
+	std::vector<std::pair<int, int>> refitRanges;
+	std::vector<int> refitTop;      // Nodes above refitRoots, refit serially afterwards in this order
+	float builtCost = 0.0f;
+	float refitCost = 0.0f;         // Unnormalized SAH cost summed during the last refit
+};
+
+template <typename F>
+bool bvh::intersect(const ray& r, float& tMax, F&& intersectPrimitive) const {
+	if (nodes.empty()) return false;
+
+	if (nodes[0].bounds.intersect(r, tMax) == FLT_MAX) return false;
+
+	bool hit = false;
+	int stack[bvhStackSize];
+	int stackSize = 0;
+	int current = 0;
+	for (;;) {
+		const bvhNode& node = nodes[current];
+		if (node.isLeaf()) {
+			for (int i = 0; i < node.count; ++i)
+				hit |= intersectPrimitive(primIndices[node.leftFirst + i], tMax);
+		}
+		else {
+			int nearChild = node.leftFirst;
+			int farChild = node.leftFirst + 1;
+			float tNear = nodes[nearChild].bounds.intersect(r, tMax);
+			float tFar = nodes[farChild].bounds.intersect(r, tMax);
+			if (tFar < tNear) {
+				std::swap(nearChild, farChild);
+				std::swap(tNear, tFar);
+			}
+			if (tNear != FLT_MAX) {
+				if (tFar != FLT_MAX) {
+					assert(stackSize < bvhStackSize);
+					stack[stackSize++] = farChild;
+				}
+				current = nearChild;
+				continue;
+			}
+		}
+
+		// Pop the next subtree, skipping any the ray can no longer reach before tMax
+		do {
+			if (stackSize == 0) return hit;
+			current = stack[--stackSize];
+		} while (nodes[current].bounds.intersect(r, tMax) == FLT_MAX);
+	}
+}
+
+template <typename F>
+bool bvh::occluded(const ray& r, float tMax, F&& occludedPrimitive) const {
+	if (nodes.empty()) return false;
+
+	if (nodes[0].bounds.intersect(r, tMax) == FLT_MAX) return false;
+
+	int stack[bvhStackSize];
+	int stackSize = 0;
+	int current = 0;
+	for (;;) {
+		const bvhNode& node = nodes[current];
+		if (node.isLeaf()) {
+			for (int i = 0; i < node.count; ++i)
+				if (occludedPrimitive(primIndices[node.leftFirst + i])) return true;
+		}
+		else {
+			int left = node.leftFirst;
+			int right = node.leftFirst + 1;
+			bool hitLeft = nodes[left].bounds.intersect(r, tMax) != FLT_MAX;
+			bool hitRight = nodes[right].bounds.intersect(r, tMax) != FLT_MAX;
+			if (hitLeft || hitRight) {
+				if (hitLeft && hitRight) {
+					assert(stackSize < bvhStackSize);
+					stack[stackSize++] = right;
+				}
+				current = hitLeft ? left : right;
+				continue;
+			}
+		}
+
+		if (stackSize == 0) return false;
+		current = stack[--stackSize];
+	}
+}
@@ -2,8 +2,10 @@
 #include "glm/ext/matrix_transform.hpp" // glm::translate, glm::rotate, glm::scale
 #include "glm/ext/matrix_clip_space.hpp" // glm::perspective
 
-camera::camera(int imageWidth, int imageHeight, glm::vec3 cameraPosition, glm::vec3 cameraTarget, glm::vec3 cameraUp) : cameraPosition(cameraPosition) {
-	pixels = std::vector<std::vector<colorRGB>>(imageHeight, std::vector<colorRGB>(imageWidth));
+camera::camera(int imageWidth, int imageHeight, glm::vec3 cameraPosition, glm::vec3 cameraTarget, glm::vec3 cameraUp, bool framebuffer)
+	: cameraPosition(cameraPosition), width(imageWidth), height(imageHeight) {
+	if (framebuffer)
+		pixels = std::vector<std::vector<colorRGB>>(imageHeight, std::vector<colorRGB>(imageWidth));
 
 	// Calculate the view matrix
 	glm::mat4 viewMatrix = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
@@ -15,4 +17,12 @@ camera::camera(int imageWidth, int imageHeight, glm::vec3 cameraPosition, glm::v
 
 	// Combine the view and projection matrices to get the camera matrix
 	cameraMatrix = projectionMatrix * viewMatrix;
+	inverseMatrix = glm::inverse(cameraMatrix);
+}
+
+ray camera::getRay(float ndcX, float ndcY) const {
+	// Unproject the pixel onto the near plane; the perspective divide is needed to get a world space point
+	glm::vec4 nearPoint = inverseMatrix * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+	glm::vec3 direction = glm::normalize(glm::vec3(nearPoint) / nearPoint.w - cameraPosition);
+	return ray(cameraPosition, direction);
 }
@@ -2,15 +2,22 @@
 #include <vector>
 #include "colorRGB.h"
 #include "glm/glm.hpp"
+#include "ray.h"
 
 class camera
 {
 public:
-	camera(int imageWidth, int imageHeight, glm::vec3 cameraPosition, glm::vec3 cameraTarget, glm::vec3 cameraUp);
+	// Without a framebuffer, pixels stays empty; for renders that stream their output
+	camera(int imageWidth, int imageHeight, glm::vec3 cameraPosition, glm::vec3 cameraTarget, glm::vec3 cameraUp, bool framebuffer = true);
 	glm::mat4 getMatrix() { return cameraMatrix; }
+	// Primary ray through the given normalized device coordinates
+	ray getRay(float ndcX, float ndcY) const;
 
 	glm::vec3 cameraPosition;
+	int width;
+	int height;
 	std::vector<std::vector<colorRGB>> pixels;
 private:
 	glm::mat4 cameraMatrix;
+	glm::mat4 inverseMatrix;
 };
@@ -0,0 +1,237 @@
+#include "checkpoint.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	const char checkpointMagic[8] = { 'W', 'R', 'T', 'C', 'K', 'P', 'T', '1' };
+
+	// 64-bit FNV-1a
+	class hasher
+	{
+	public:
+		void bytes(const void* data, size_t size) {
+			const unsigned char* p = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; ++i)
+				value = (value ^ p[i]) * 0x100000001B3ull;
+		}
+		template <typename T>
+		void add(const T& v) { bytes(&v, sizeof(v)); }
+		template <typename T>
+		void add(const std::vector<T>& v) {
+			add(v.size());
+			bytes(v.data(), v.size() * sizeof(T));
+		}
+		void add(const glm::vec3& v) { add(v.x); add(v.y); add(v.z); }
+		void add(const colorRGB& c) { add(c.r); add(c.g); add(c.b); }
+
+		uint64_t value = 0xCBF29CE484222325ull;
+	};
+
+	// Writes a temporary file next to filename, flushes it to disk and renames it over filename
+	bool replaceFile(const std::string& filename, const std::vector<unsigned char>& bytes) {
+		std::string temporary = filename + ".tmp";
+#ifdef _WIN32
+		HANDLE file = CreateFileA(temporary.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		bool written = true;
+		for (size_t offset = 0; written && offset < bytes.size();) {
+			DWORD chunk = static_cast<DWORD>(bytes.size() - offset < (1u << 30) ? bytes.size() - offset : (1u << 30)), count = 0;
+			written = WriteFile(file, bytes.data() + offset, chunk, &count, nullptr) && count == chunk;
+			offset += count;
+		}
+		written = FlushFileBuffers(file) && written;
+		CloseHandle(file);
+		return written && MoveFileExA(temporary.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		int file = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (file < 0) return false;
+		bool written = true;
+		for (size_t offset = 0; written && offset < bytes.size();) {
+			ssize_t count = write(file, bytes.data() + offset, bytes.size() - offset);
+			written = count > 0;
+			offset += written ? static_cast<size_t>(count) : 0;
+		}
+		written = fsync(file) == 0 && written;
+		written = close(file) == 0 && written;
+		return written && std::rename(temporary.c_str(), filename.c_str()) == 0;
+#endif
+	}
+}
+
+uint64_t renderSetupHash(const scene& world, const camera& cam, const renderSettings& settings) {
+	hasher h;
+	for (const sphere& s : world.spheres) {
+		h.add(s.center);
+		h.add(s.radius);
+		h.add(s.material);
+	}
+	for (const mesh& m : world.meshes) {
+		h.add(m.vertices);
+		h.add(m.triangles);
+	}
+	for (const instance& i : world.instances) {
+		h.add(i.meshIndex);
+		h.add(i.material);
+		for (int column = 0; column < 4; ++column)
+			h.add(i.objectToWorld[column]);
+	}
+	for (const light& l : world.lights) {
+		h.add(l.position);
+		h.add(l.intensity);
+		h.add(l.range);
+	}
+	h.add(world.materials.diffuse);
+	h.add(world.materials.specular);
+	h.add(world.materials.shininess);
+	h.add(world.materials.reflectivity);
+	h.add(world.materials.transmissivity);
+	h.add(world.materials.ior);
+
+	// The corner rays pin down position, orientation and field of view
+	h.add(cam.width);
+	h.add(cam.height);
+	for (float y : { -1.0f, 1.0f })
+		for (float x : { -1.0f, 1.0f }) {
+			ray r = cam.getRay(x, y);
+			h.add(r.origin());
+			h.add(r.direction());
+		}
+
+	h.add(settings.maxDepth);
+	h.add(settings.minContribution);
+	h.add(static_cast<int>(settings.antialiasing));
+	h.add(settings.samplesPerAxis);
+	h.add(settings.adaptiveThreshold);
+	h.add(settings.adaptiveDepth);
+	h.add(settings.specializedShading);
+	h.add(settings.lightTree);
+	h.add(settings.minLightContribution);
+	h.add(settings.transparentShadows);
+	h.add(settings.minTransmittance);
+	h.add(settings.occluderCache);
+	return h.value;
+}
+
+renderCheckpoint::renderCheckpoint(const char* filename, uint64_t setupHash, int width, int height, double interval)
+	: filename(filename), setupHash(setupHash), width(width), height(height), interval(interval), done(height, false),
+	start(std::chrono::steady_clock::now()) {}
+
+int renderCheckpoint::resume(camera& cam) {
+	std::ifstream file(filename, std::ios::binary);
+	std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	size_t bitmapSize = (static_cast<size_t>(height) + 7) / 8;
+	size_t headerSize = sizeof(checkpointMagic) + sizeof(uint64_t) + 2 * sizeof(int32_t);
+	if (bytes.size() < headerSize + bitmapSize || std::memcmp(bytes.data(), checkpointMagic, sizeof(checkpointMagic)) != 0)
+		return 0;
+	uint64_t hash;
+	int32_t size[2];
+	std::memcpy(&hash, bytes.data() + sizeof(checkpointMagic), sizeof(hash));
+	std::memcpy(size, bytes.data() + sizeof(checkpointMagic) + sizeof(hash), sizeof(size));
+	if (hash != setupHash || size[0] != width || size[1] != height)
+		return 0;
+
+	const unsigned char* bitmap = bytes.data() + headerSize;
+	const unsigned char* rows = bitmap + bitmapSize;
+	size_t rowBytes = static_cast<size_t>(width) * sizeof(colorRGB);
+	int restored = 0;
+	for (int y = 0; y < height; ++y)
+		restored += (bitmap[y / 8] >> (y % 8)) & 1;
+	if (bytes.size() != headerSize + bitmapSize + restored * rowBytes)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(stateMutex);
+	for (int y = 0; y < height; ++y) {
+		if (!((bitmap[y / 8] >> (y % 8)) & 1)) continue;
+		std::memcpy(cam.pixels[y].data(), rows, rowBytes);
+		rows += rowBytes;
+		done[y] = true;
+	}
+	doneCount = restored;
+	return restored;
+}
+
+bool renderCheckpoint::finished(int first, int last) {
+	std::lock_guard<std::mutex> lock(stateMutex);
+	for (int y = first; y < last; ++y)
+		if (!done[y]) return false;
+	return true;
+}
+
+void renderCheckpoint::rowsDone(int first, int last, const camera& cam) {
+	int finishedRows;
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		for (int y = first; y < last; ++y) {
+			doneCount += done[y] ? 0 : 1;
+			done[y] = true;
+		}
+		finishedRows = doneCount;
+	}
+	std::unique_lock<std::mutex> saving(saveMutex, std::try_to_lock);
+	if (!saving.owns_lock()) return;
+	// Due once the interval has passed and the next checkpoint fits in the budget of the time so far. Its cost is
+	// estimated from the last one, which grows with the scanlines it holds
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double estimate = lastRows > 0 ? lastCost * finishedRows / lastRows : 0.0;
+	if (elapsed - lastSave < interval || spent + estimate > maxOverhead * elapsed) return;
+	saveLocked(cam);
+}
+
+bool renderCheckpoint::save(const camera& cam) {
+	std::lock_guard<std::mutex> saving(saveMutex);
+	return saveLocked(cam);
+}
+
+bool renderCheckpoint::saveLocked(const camera& cam) {
+	auto saveStart = std::chrono::steady_clock::now();
+
+	std::vector<unsigned char> bitmap((static_cast<size_t>(height) + 7) / 8, 0);
+	int finishedRows = 0;
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		for (int y = 0; y < height; ++y)
+			if (done[y]) {
+				bitmap[y / 8] |= static_cast<unsigned char>(1 << (y % 8));
+				++finishedRows;
+			}
+	}
+
+	// Finished scanlines are never written again, so they can be read while the render goes on
+	size_t rowBytes = static_cast<size_t>(width) * sizeof(colorRGB);
+	std::vector<unsigned char> bytes(checkpointMagic, checkpointMagic + sizeof(checkpointMagic));
+	int32_t size[2] = { width, height };
+	bytes.resize(bytes.size() + sizeof(setupHash) + sizeof(size) + bitmap.size() + finishedRows * rowBytes);
+	unsigned char* p = bytes.data() + sizeof(checkpointMagic);
+	std::memcpy(p, &setupHash, sizeof(setupHash));
+	std::memcpy(p += sizeof(setupHash), size, sizeof(size));
+	std::memcpy(p += sizeof(size), bitmap.data(), bitmap.size());
+	p += bitmap.size();
+	for (int y = 0; y < height; ++y)
+		if ((bitmap[y / 8] >> (y % 8)) & 1) {
+			std::memcpy(p, cam.pixels[y].data(), rowBytes);
+			p += rowBytes;
+		}
+	bool written = replaceFile(filename, bytes);
+
+	auto now = std::chrono::steady_clock::now();
+	lastCost = std::chrono::duration<double>(now - saveStart).count();
+	lastSave = std::chrono::duration<double>(now - start).count();
+	lastRows = finishedRows;
+	spent += lastCost;
+	++saves;
+	return written;
+}
+
+void renderCheckpoint::remove() {
+	std::remove(filename.c_str());
+}
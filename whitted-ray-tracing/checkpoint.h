@@ -0,0 +1,67 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "camera.h"
+#include "renderSettings.h"
+#include "scene.h"
+
+// Hash of everything that decides the colors of a frame: the scene, the camera and the render settings.
+// A checkpoint is only resumed by a render with the same hash
+uint64_t renderSetupHash(const scene& world, const camera& cam, const renderSettings& settings);
+
+// Periodic snapshots of a render in progress, so that a render killed part way can resume without redoing the
+// scanlines it had finished. A checkpoint file holds the setup hash, a bitmap of the finished scanlines and their
+// pixels. It is written to a temporary file, flushed to disk and renamed over the previous one, so a crash
+// leaves either the old checkpoint or the new one, never a torn file
+class renderCheckpoint
+{
+public:
+	// Checkpoints at most every interval seconds, and only while the time spent writing them stays under 1% of
+	// the time since construction
+	renderCheckpoint(const char* filename, uint64_t setupHash, int width, int height, double interval = 60.0);
+
+	// Loads the checkpoint into cam.pixels if one exists for this setup and marks its scanlines finished.
+	// Returns the number of scanlines restored
+	int resume(camera& cam);
+
+	// Whether scanlines [first, last) are all finished
+	bool finished(int first, int last);
+
+	// Marks scanlines [first, last) of cam.pixels finished. Called by the render threads; the one that finds a
+	// checkpoint due writes it, unless another is already writing one
+	void rowsDone(int first, int last, const camera& cam);
+
+	// Writes a checkpoint of the finished scanlines now. Returns false if it could not be written
+	bool save(const camera& cam);
+
+	// Deletes the checkpoint file, once the finished image is safely written
+	void remove();
+
+	int saveCount() const { return saves; }
+	double saveSeconds() const { return spent; }
+
+private:
+	static constexpr double maxOverhead = 0.01;
+
+	// save() with saveMutex already held by the caller
+	bool saveLocked(const camera& cam);
+
+	std::string filename;
+	uint64_t setupHash;
+	int width;
+	int height;
+	double interval;
+	std::mutex stateMutex;      // Guards done and doneCount
+	std::mutex saveMutex;       // Held while writing, and guards the timing below
+	std::vector<bool> done;
+	int doneCount = 0;
+	std::chrono::steady_clock::time_point start;
+	double lastSave = 0.0;      // Seconds since start
+	double lastCost = 0.0;
+	int lastRows = 0;           // Scanlines in the last checkpoint
+	double spent = 0.0;
+	int saves = 0;
+};
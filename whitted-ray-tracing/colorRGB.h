@@ -17,6 +17,11 @@ public:
 		return colorRGB(r * scalar, g * scalar, b * scalar);
 	}
 
+	// Component-wise product, for filtering light by a surface color
+	colorRGB operator*(const colorRGB& c) const {
+		return colorRGB(r * c.r, g * c.g, b * c.b);
+	}
+
 	// Overloaded + operator
 	colorRGB operator+(colorRGB c) const {
 		return colorRGB(r + c.r, g + c.g, b + c.b);
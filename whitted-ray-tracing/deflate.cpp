@@ -0,0 +1,373 @@
+#include "deflate.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	constexpr int windowSize = 32768;
+	constexpr int minMatch = 3;
+	constexpr int maxMatch = 258;
+	constexpr int hashBits = 15;
+	// Candidates tried per position. Longer chains find slightly longer matches for a lot more time
+	constexpr int maxChain = 32;
+	// Symbols gathered before a block is closed and gets its own Huffman tables
+	constexpr int blockSymbols = 1 << 16;
+
+	constexpr int literalCodes = 286;
+	constexpr int distanceCodes = 30;
+	constexpr int lengthCodes = 19;
+	constexpr int endOfBlock = 256;
+
+	const int lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const int lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const int distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+		4097, 6145, 8193, 12289, 16385, 24577 };
+	const int distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	// Order the code length code lengths are sent in
+	const int lengthOrder[lengthCodes] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	struct codeTables {
+		unsigned char lengthSymbol[maxMatch + 1];   // Match length to length code, minus 257
+		unsigned char distanceSymbol[512];          // See distanceCode
+		uint32_t crc[256];
+
+		codeTables() {
+			for (int code = 0; code < 29; ++code)
+				for (int length = lengthBase[code]; length < (code + 1 < 29 ? lengthBase[code + 1] : maxMatch + 1); ++length)
+					lengthSymbol[length] = static_cast<unsigned char>(code);
+			for (int code = 0; code < distanceCodes; ++code)
+				for (int d = distanceBase[code]; d < (code + 1 < distanceCodes ? distanceBase[code + 1] : windowSize + 1); ++d) {
+					int index = d <= 256 ? d - 1 : 256 + ((d - 1) >> 7);
+					distanceSymbol[index] = static_cast<unsigned char>(code);
+				}
+			for (uint32_t n = 0; n < 256; ++n) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; ++k)
+					c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				crc[n] = c;
+			}
+		}
+
+		int distanceCode(int distance) const { return distanceSymbol[distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7)]; }
+	};
+
+	const codeTables& tables() {
+		static const codeTables t;
+		return t;
+	}
+
+	// LSB-first bit packing as deflate wants it
+	struct bitWriter {
+		std::vector<unsigned char>& out;
+		uint64_t bits = 0;
+		int count = 0;
+
+		void put(uint32_t value, int n) {
+			bits |= static_cast<uint64_t>(value) << count;
+			count += n;
+			while (count >= 8) {
+				out.push_back(static_cast<unsigned char>(bits));
+				bits >>= 8;
+				count -= 8;
+			}
+		}
+
+		void alignToByte() {
+			if (count > 0) out.push_back(static_cast<unsigned char>(bits));
+			bits = 0;
+			count = 0;
+		}
+	};
+
+	// Huffman code lengths of at most limit bits for the symbols with nonzero frequency. The code is always
+	// complete, which inflaters insist on, so at least two symbols must be used
+	void buildLengths(const uint32_t* frequencies, int count, int limit, unsigned char* lengths) {
+		std::fill(lengths, lengths + count, 0);
+		struct node { uint64_t weight; int left, right; };
+		std::vector<node> nodes;
+		std::vector<int> leaves;
+		for (int i = 0; i < count; ++i)
+			if (frequencies[i] > 0) leaves.push_back(i);
+		std::sort(leaves.begin(), leaves.end(), [&](int a, int b) { return frequencies[a] < frequencies[b]; });
+		for (int symbol : leaves)
+			nodes.push_back({ frequencies[symbol], -1, symbol });
+
+		// Two-queue Huffman: leaves in weight order, merged nodes are created in weight order as well
+		size_t nextLeaf = 0, nextMerged = leaves.size();
+		auto takeSmallest = [&]() {
+			if (nextLeaf < leaves.size() && (nextMerged >= nodes.size() || nodes[nextLeaf].weight <= nodes[nextMerged].weight))
+				return static_cast<int>(nextLeaf++);
+			return static_cast<int>(nextMerged++);
+		};
+		for (size_t merges = 1; merges < leaves.size(); ++merges) {
+			int a = takeSmallest();
+			int b = takeSmallest();
+			nodes.push_back({ nodes[a].weight + nodes[b].weight, a, b });
+		}
+
+		// Depths from the root down; a leaf's right field holds its symbol
+		std::vector<int> depth(nodes.size(), 0);
+		for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; --i) {
+			if (nodes[i].left < 0) lengths[nodes[i].right] = static_cast<unsigned char>(std::min(std::max(depth[i], 1), limit));
+			else depth[nodes[i].left] = depth[nodes[i].right] = depth[i] + 1;
+		}
+
+		// Clamping deep leaves oversubscribes the code: lengthen the rarest symbols until it fits, then shorten
+		// the most frequent ones while there is room, so the code ends up exactly complete
+		int64_t capacity = int64_t(1) << limit;
+		int64_t used = 0;
+		for (int symbol : leaves)
+			used += int64_t(1) << (limit - lengths[symbol]);
+		for (size_t i = 0; used > capacity; i = (i + 1) % leaves.size()) {
+			unsigned char& length = lengths[leaves[i]];
+			if (length < limit) {
+				used -= int64_t(1) << (limit - length - 1);
+				++length;
+			}
+		}
+		while (used < capacity) {
+			for (size_t i = leaves.size(); i-- > 0 && used < capacity;) {
+				unsigned char& length = lengths[leaves[i]];
+				int64_t gain = int64_t(1) << (limit - length);
+				if (length > 1 && used + gain <= capacity) {
+					used += gain;
+					--length;
+				}
+			}
+		}
+	}
+
+	// Canonical codes for the lengths, bit-reversed for the LSB-first writer
+	void assignCodes(const unsigned char* lengths, int count, uint16_t* codes) {
+		int lengthCount[16] = {};
+		for (int i = 0; i < count; ++i) lengthCount[lengths[i]]++;
+		lengthCount[0] = 0;
+		int next[16] = {};
+		int code = 0;
+		for (int bits = 1; bits < 16; ++bits) {
+			code = (code + lengthCount[bits - 1]) << 1;
+			next[bits] = code;
+		}
+		for (int i = 0; i < count; ++i) {
+			int length = lengths[i];
+			if (length == 0) continue;
+			int c = next[length]++;
+			int reversed = 0;
+			for (int b = 0; b < length; ++b)
+				reversed |= ((c >> b) & 1) << (length - 1 - b);
+			codes[i] = static_cast<uint16_t>(reversed);
+		}
+	}
+
+	// A literal (distance 0) or a match
+	struct symbol {
+		uint16_t length;
+		uint16_t distance;
+	};
+
+	void writeBlock(bitWriter& writer, const std::vector<symbol>& symbols, bool final) {
+		const codeTables& t = tables();
+		uint32_t literalFrequency[literalCodes] = {};
+		uint32_t distanceFrequency[distanceCodes] = {};
+		for (const symbol& s : symbols) {
+			if (s.distance == 0) literalFrequency[s.length]++;
+			else {
+				literalFrequency[257 + t.lengthSymbol[s.length]]++;
+				distanceFrequency[t.distanceCode(s.distance)]++;
+			}
+		}
+		literalFrequency[endOfBlock] = 1;
+		// Keep at least two codes in each alphabet so every code is complete
+		for (uint32_t* frequency : { literalFrequency, distanceFrequency }) {
+			if (frequency[0] == 0) frequency[0] = 1;
+			if (frequency[1] == 0) frequency[1] = 1;
+		}
+
+		unsigned char literalLengths[literalCodes], distanceLengths[distanceCodes];
+		buildLengths(literalFrequency, literalCodes, 15, literalLengths);
+		buildLengths(distanceFrequency, distanceCodes, 15, distanceLengths);
+		int literalCount = literalCodes;
+		while (literalCount > 257 && literalLengths[literalCount - 1] == 0) --literalCount;
+		int distanceCount = distanceCodes;
+		while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0) --distanceCount;
+
+		// Both length lists run-length coded with the code length alphabet: 16 repeats the previous length
+		// 3-6 times, 17 and 18 are runs of 3-10 and 11-138 zeros
+		unsigned char all[literalCodes + distanceCodes];
+		std::memcpy(all, literalLengths, literalCount);
+		std::memcpy(all + literalCount, distanceLengths, distanceCount);
+		int total = literalCount + distanceCount;
+		struct lengthSymbol { unsigned char code, extra; };
+		std::vector<lengthSymbol> runs;
+		uint32_t lengthFrequency[lengthCodes] = {};
+		for (int i = 0; i < total;) {
+			int run = 1;
+			while (i + run < total && all[i + run] == all[i]) ++run;
+			if (all[i] == 0 && run >= 3) {
+				int n = std::min(run, 138);
+				runs.push_back(n >= 11 ? lengthSymbol{ 18, static_cast<unsigned char>(n - 11) } : lengthSymbol{ 17, static_cast<unsigned char>(n - 3) });
+				i += n;
+			}
+			else if (all[i] != 0 && run >= 4) {
+				runs.push_back({ all[i], 0 });
+				int n = std::min(run - 1, 6);
+				runs.push_back({ 16, static_cast<unsigned char>(n - 3) });
+				i += 1 + n;
+			}
+			else {
+				runs.push_back({ all[i], 0 });
+				++i;
+			}
+		}
+		for (const lengthSymbol& r : runs) lengthFrequency[r.code]++;
+		if (lengthFrequency[0] == 0) lengthFrequency[0] = 1;
+		if (lengthFrequency[18] == 0) lengthFrequency[18] = 1;
+		unsigned char codeLengthLengths[lengthCodes];
+		buildLengths(lengthFrequency, lengthCodes, 7, codeLengthLengths);
+		int codeLengthCount = lengthCodes;
+		while (codeLengthCount > 4 && codeLengthLengths[lengthOrder[codeLengthCount - 1]] == 0) --codeLengthCount;
+
+		uint16_t literalCodesOut[literalCodes] = {}, distanceCodesOut[distanceCodes] = {}, codeLengthCodes[lengthCodes] = {};
+		assignCodes(literalLengths, literalCodes, literalCodesOut);
+		assignCodes(distanceLengths, distanceCodes, distanceCodesOut);
+		assignCodes(codeLengthLengths, lengthCodes, codeLengthCodes);
+
+		writer.put(final ? 1 : 0, 1);
+		writer.put(2, 2);   // Dynamic Huffman
+		writer.put(literalCount - 257, 5);
+		writer.put(distanceCount - 1, 5);
+		writer.put(codeLengthCount - 4, 4);
+		for (int i = 0; i < codeLengthCount; ++i)
+			writer.put(codeLengthLengths[lengthOrder[i]], 3);
+		for (const lengthSymbol& r : runs) {
+			writer.put(codeLengthCodes[r.code], codeLengthLengths[r.code]);
+			if (r.code == 16) writer.put(r.extra, 2);
+			else if (r.code == 17) writer.put(r.extra, 3);
+			else if (r.code == 18) writer.put(r.extra, 7);
+		}
+
+		for (const symbol& s : symbols) {
+			if (s.distance == 0) {
+				writer.put(literalCodesOut[s.length], literalLengths[s.length]);
+				continue;
+			}
+			int lengthCode = t.lengthSymbol[s.length];
+			writer.put(literalCodesOut[257 + lengthCode], literalLengths[257 + lengthCode]);
+			writer.put(s.length - lengthBase[lengthCode], lengthExtra[lengthCode]);
+			int distanceCode = t.distanceCode(s.distance);
+			writer.put(distanceCodesOut[distanceCode], distanceLengths[distanceCode]);
+			writer.put(s.distance - distanceBase[distanceCode], distanceExtra[distanceCode]);
+		}
+		writer.put(literalCodesOut[endOfBlock], literalLengths[endOfBlock]);
+	}
+
+	uint32_t hash3(const unsigned char* p) {
+		uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+		return (v * 2654435761u) >> (32 - hashBits);
+	}
+}
+
+void deflateChunk(const unsigned char* data, size_t size, size_t dictionarySize, bool last, std::vector<unsigned char>& out) {
+	dictionarySize = std::min<size_t>(dictionarySize, windowSize);
+	const unsigned char* base = data - dictionarySize;
+	const int end = static_cast<int>(dictionarySize + size);
+
+	std::vector<int> head(size_t(1) << hashBits, -1);
+	std::vector<int> previous(windowSize, -1);
+	auto insert = [&](int position) {
+		uint32_t h = hash3(base + position);
+		previous[position & (windowSize - 1)] = head[h];
+		head[h] = position;
+	};
+	for (int position = 0; position + minMatch <= static_cast<int>(dictionarySize); ++position)
+		insert(position);
+
+	bitWriter writer{ out };
+	std::vector<symbol> symbols;
+	symbols.reserve(blockSymbols);
+	int position = static_cast<int>(dictionarySize);
+	while (position < end) {
+		int bestLength = 0, bestDistance = 0;
+		if (position + minMatch <= end) {
+			int limit = std::min(maxMatch, end - position);
+			int candidate = head[hash3(base + position)];
+			for (int chain = 0; chain < maxChain && candidate >= 0 && position - candidate <= windowSize; ++chain) {
+				// Quick reject on the byte that would make the match longer than the best so far
+				if (base[candidate + bestLength] == base[position + bestLength]) {
+					int length = 0;
+					while (length < limit && base[candidate + length] == base[position + length]) ++length;
+					if (length > bestLength) {
+						bestLength = length;
+						bestDistance = position - candidate;
+						if (length == limit) break;
+					}
+				}
+				candidate = previous[candidate & (windowSize - 1)];
+			}
+		}
+
+		if (bestLength >= minMatch) {
+			symbols.push_back({ static_cast<uint16_t>(bestLength), static_cast<uint16_t>(bestDistance) });
+			for (int k = 0; k < bestLength; ++k, ++position)
+				if (position + minMatch <= end) insert(position);
+		}
+		else {
+			symbols.push_back({ base[position], 0 });
+			if (position + minMatch <= end) insert(position);
+			++position;
+		}
+
+		if (static_cast<int>(symbols.size()) == blockSymbols) {
+			writeBlock(writer, symbols, last && position == end);
+			symbols.clear();
+		}
+	}
+	if (!symbols.empty() || (last && size == 0))
+		writeBlock(writer, symbols, last);
+
+	if (!last) {
+		// Empty stored block: flushes to a byte boundary without ending the stream
+		writer.put(0, 3);
+		writer.alignToByte();
+		const unsigned char stored[4] = { 0x00, 0x00, 0xFF, 0xFF };
+		out.insert(out.end(), stored, stored + 4);
+	}
+	else
+		writer.alignToByte();
+}
+
+uint32_t adler32(const unsigned char* data, size_t size, uint32_t adler) {
+	const uint32_t modulus = 65521;
+	uint32_t a = adler & 0xFFFF, b = adler >> 16;
+	while (size > 0) {
+		// Largest run that can't overflow b before reducing
+		size_t n = std::min<size_t>(size, 5552);
+		size -= n;
+		while (n--) {
+			a += *data++;
+			b += a;
+		}
+		a %= modulus;
+		b %= modulus;
+	}
+	return a | (b << 16);
+}
+
+uint32_t adler32Combine(uint32_t first, uint32_t second, size_t secondSize) {
+	const uint32_t modulus = 65521;
+	uint32_t remainder = static_cast<uint32_t>(secondSize % modulus);
+	uint32_t a = first & 0xFFFF;
+	uint32_t b = static_cast<uint32_t>((static_cast<uint64_t>(remainder) * a) % modulus);
+	a += (second & 0xFFFF) + modulus - 1;
+	b += (first >> 16) + (second >> 16) + modulus - remainder;
+	a %= modulus;
+	b %= modulus;
+	return a | (b << 16);
+}
+
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc) {
+	const uint32_t* table = tables().crc;
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compresses data[0, size) as a sequence of dynamic Huffman deflate blocks appended to out. The dictionarySize
+// bytes just before data are what the decoder will already have produced, so matches may reach back into them;
+// chunks of one stream can therefore be compressed independently and concatenated. Unless last is set, the chunk
+// ends with an empty stored block so the next one starts on a byte boundary
+void deflateChunk(const unsigned char* data, size_t size, size_t dictionarySize, bool last, std::vector<unsigned char>& out);
+
+uint32_t adler32(const unsigned char* data, size_t size, uint32_t adler = 1);
+// Adler-32 of two pieces joined, from the checksum of each and the length of the second
+uint32_t adler32Combine(uint32_t first, uint32_t second, size_t secondSize);
+
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0);
@@ -0,0 +1,163 @@
+#include "frameStream.h"
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// BT.601 in limited range, from gamma encoded 8-bit RGB
+	unsigned char lumaOf(int r, int g, int b) {
+		return static_cast<unsigned char>((66 * r + 129 * g + 25 * b + 128 + (16 << 8)) >> 8);
+	}
+
+	unsigned char chromaBlue(int r, int g, int b) {
+		return static_cast<unsigned char>((-38 * r - 74 * g + 112 * b + 128 + (128 << 8)) >> 8);
+	}
+
+	unsigned char chromaRed(int r, int g, int b) {
+		return static_cast<unsigned char>((112 * r - 94 * g - 18 * b + 128 + (128 << 8)) >> 8);
+	}
+
+	// Full resolution luma, then both chroma planes at half resolution from the average of each 2x2 block.
+	// The last column and row stand in for their missing neighbours in odd sizes
+	void toYUV420(const unsigned char* rgb, int width, int height, unsigned char* out) {
+		unsigned char* luma = out;
+		for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i)
+			luma[i] = lumaOf(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+
+		int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+		unsigned char* blue = luma + static_cast<size_t>(width) * height;
+		unsigned char* red = blue + static_cast<size_t>(chromaWidth) * chromaHeight;
+		for (int y = 0; y < chromaHeight; ++y)
+			for (int x = 0; x < chromaWidth; ++x) {
+				int sum[3] = { 0, 0, 0 };
+				for (int dy = 0; dy < 2; ++dy)
+					for (int dx = 0; dx < 2; ++dx) {
+						int sx = 2 * x + dx < width ? 2 * x + dx : width - 1;
+						int sy = 2 * y + dy < height ? 2 * y + dy : height - 1;
+						const unsigned char* p = rgb + (static_cast<size_t>(sy) * width + sx) * 3;
+						sum[0] += p[0];
+						sum[1] += p[1];
+						sum[2] += p[2];
+					}
+				int r = (sum[0] + 2) / 4, g = (sum[1] + 2) / 4, b = (sum[2] + 2) / 4;
+				blue[static_cast<size_t>(y) * chromaWidth + x] = chromaBlue(r, g, b);
+				red[static_cast<size_t>(y) * chromaWidth + x] = chromaRed(r, g, b);
+			}
+	}
+}
+
+bool frameStream::open(const char* path, int streamWidth, int streamHeight, streamFormat streamFormat, int rate) {
+	close();
+	width = streamWidth;
+	height = streamHeight;
+	format = streamFormat;
+	framesPerSecond = rate > 0 ? rate : 24;
+	failed = false;
+	headerWritten = false;
+	frames = 0;
+	bool standardOutput = std::strcmp(path, "-") == 0;
+#ifdef _WIN32
+	if (standardOutput)
+		file = GetStdHandle(STD_OUTPUT_HANDLE);
+	else {
+		// A pipe's server end already exists; creating or truncating only applies to files
+		bool pipe = std::strncmp(path, "\\\\.\\pipe\\", 9) == 0;
+		HANDLE handle = CreateFileA(path, GENERIC_WRITE, 0, nullptr, pipe ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		file = handle == INVALID_HANDLE_VALUE ? nullptr : handle;
+	}
+	ownsFile = !standardOutput;
+	return file != nullptr;
+#else
+	// A reader closing the pipe should fail the write, not kill the process
+	std::signal(SIGPIPE, SIG_IGN);
+	// Opening a named pipe waits for the reader to open the other end
+	file = standardOutput ? STDOUT_FILENO : ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	ownsFile = !standardOutput;
+	return file >= 0;
+#endif
+}
+
+bool frameStream::writeFrame(const std::vector<std::vector<colorRGB>>& pixels, const tonemapSettings& tonemap) {
+	if (failed || static_cast<int>(pixels.size()) != height || (height > 0 && static_cast<int>(pixels[0].size()) != width)) {
+		failed = true;
+		return false;
+	}
+	size_t pixelCount = static_cast<size_t>(width) * height;
+	char header[128];
+	int headerSize = 0;
+	size_t payload;
+	if (format == streamFormat::ppm) {
+		headerSize = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+		payload = pixelCount * 3;
+	}
+	else {
+		// The stream header goes in front of the first frame
+		if (!headerWritten)
+			headerSize = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond);
+		headerSize += std::snprintf(header + headerSize, sizeof(header) - headerSize, "FRAME\n");
+		payload = pixelCount + 2 * static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+	}
+
+	buffer.resize(headerSize + payload);
+	std::memcpy(buffer.data(), header, headerSize);
+	if (format == streamFormat::ppm)
+		quantizeImage(pixels, tonemap, buffer.data() + headerSize);
+	else {
+		levels.resize(pixelCount * 3);
+		quantizeImage(pixels, tonemap, levels.data());
+		toYUV420(levels.data(), width, height, buffer.data() + headerSize);
+	}
+	if (!writeAll(buffer.data(), buffer.size())) {
+		failed = true;
+		return false;
+	}
+	headerWritten = true;
+	++frames;
+	return true;
+}
+
+bool frameStream::writeAll(const unsigned char* data, size_t size) {
+	// Pipes may take less than asked at a time
+	while (size > 0) {
+#ifdef _WIN32
+		DWORD chunk = static_cast<DWORD>(size < (1u << 30) ? size : (1u << 30)), count = 0;
+		if (!WriteFile(file, data, chunk, &count, nullptr) || count == 0) return false;
+#else
+		ssize_t count = ::write(file, data, size);
+		if (count < 0 && errno == EINTR) continue;
+		if (count <= 0) return false;
+#endif
+		data += count;
+		size -= static_cast<size_t>(count);
+	}
+	return true;
+}
+
+bool frameStream::close() {
+#ifdef _WIN32
+	if (file && ownsFile) CloseHandle(file);
+	file = nullptr;
+#else
+	if (file >= 0 && ownsFile && ::close(file) != 0)
+		failed = true;
+	file = -1;
+#endif
+	ownsFile = false;
+	return !failed;
+}
+
+bool parseStreamFormat(const char* name, streamFormat& format) {
+	if (std::strcmp(name, "p6") == 0) format = streamFormat::ppm;
+	else if (std::strcmp(name, "y4m") == 0) format = streamFormat::y4m;
+	else return false;
+	return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "colorRGB.h"
+#include "tonemap.h"
+
+enum class streamFormat {
+	ppm,    // Concatenated binary PPM (P6) images, as read by image2pipe style inputs
+	y4m,    // YUV4MPEG2 with 4:2:0 chroma in limited range BT.601, the raw video format encoders read from pipes
+};
+
+// A continuous stream of frames to stdout, a file or a named pipe, for an encoder process to consume. Each frame is
+// converted straight into one buffer, header included, and goes out in a single large write. Writes block while
+// the reader lags behind, so call writeFrame from the output thread, where that holds up no render thread
+class frameStream
+{
+public:
+	frameStream() {}
+	~frameStream() { close(); }
+	frameStream(const frameStream&) = delete;
+	frameStream& operator=(const frameStream&) = delete;
+
+	// Opens path for writing, "-" being stdout. On Windows, paths starting with \\.\pipe\ connect to an existing
+	// named pipe. Returns false on failure
+	bool open(const char* path, int width, int height, streamFormat format, int framesPerSecond = 24);
+
+	// Appends one frame, which must have the size given to open. Returns false once the stream failed, for example
+	// because the reader went away
+	bool writeFrame(const std::vector<std::vector<colorRGB>>& pixels, const tonemapSettings& tonemap = tonemapSettings());
+
+	// Closes the stream, leaving stdout open. Returns false if any write failed
+	bool close();
+
+	long long framesWritten() const { return frames; }
+
+private:
+	bool writeAll(const unsigned char* data, size_t size);
+
+	int width = 0;
+	int height = 0;
+	streamFormat format = streamFormat::ppm;
+	bool failed = false;
+	bool headerWritten = false;
+	int framesPerSecond = 24;
+	long long frames = 0;
+	std::vector<unsigned char> levels;
+	std::vector<unsigned char> buffer;
+#ifdef _WIN32
+	void* file = nullptr;
+	bool ownsFile = false;
+#else
+	int file = -1;
+	bool ownsFile = false;
+#endif
+};
+
+// Parses "p6" or "y4m". Returns false for anything else
+bool parseStreamFormat(const char* name, streamFormat& format);
@@ -0,0 +1,146 @@
+#include "grid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	constexpr int maxResolution = 128;
+	constexpr int mailboxSize = 16;
+
+	// Remembers the last primitives tested by one ray, indexed by the low bits of the primitive index
+	struct mailbox {
+		int slots[mailboxSize];
+
+		mailbox() { std::fill(slots, slots + mailboxSize, -1); }
+
+		// Returns true if the primitive was already tested, otherwise records it
+		bool seen(int prim) {
+			int& slot = slots[prim & (mailboxSize - 1)];
+			if (slot == prim) return true;
+			slot = prim;
+			return false;
+		}
+	};
+}
+
+void uniformGrid::build(const std::vector<aabb>& primBounds) {
+	bounds = aabb();
+	for (const aabb& b : primBounds)
+		bounds.expand(b);
+	cellStart.clear();
+	cellPrims.clear();
+	resolution = glm::ivec3(0);
+	if (primBounds.empty()) return;
+
+	// Pick cubic-ish cells so that there are about density cells per primitive
+	glm::vec3 extent = bounds.max - bounds.min;
+	float minExtent = 1e-4f * glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 1e-2f));
+	extent = glm::max(extent, glm::vec3(minExtent));
+	bounds.max = bounds.min + extent;
+	float cellsPerUnit = std::cbrt(density * primBounds.size() / (extent.x * extent.y * extent.z));
+	for (int axis = 0; axis < 3; ++axis)
+		resolution[axis] = glm::clamp(static_cast<int>(extent[axis] * cellsPerUnit), 1, maxResolution);
+	cellSize = extent / glm::vec3(resolution);
+
+	auto cellRange = [&](const aabb& b, glm::ivec3& lo, glm::ivec3& hi) {
+		lo = glm::clamp(glm::ivec3((b.min - bounds.min) / cellSize), glm::ivec3(0), resolution - 1);
+		hi = glm::clamp(glm::ivec3((b.max - bounds.min) / cellSize), glm::ivec3(0), resolution - 1);
+	};
+
+	// Count primitives per cell, turn the counts into offsets, then scatter
+	int cellCount = resolution.x * resolution.y * resolution.z;
+	cellStart.assign(cellCount + 1, 0);
+	glm::ivec3 lo, hi;
+	for (const aabb& b : primBounds) {
+		cellRange(b, lo, hi);
+		for (int z = lo.z; z <= hi.z; ++z)
+			for (int y = lo.y; y <= hi.y; ++y)
+				for (int x = lo.x; x <= hi.x; ++x)
+					cellStart[cellIndex(x, y, z) + 1]++;
+	}
+	for (int i = 0; i < cellCount; ++i)
+		cellStart[i + 1] += cellStart[i];
+
+	cellPrims.resize(cellStart[cellCount]);
+	std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+	for (int prim = 0; prim < static_cast<int>(primBounds.size()); ++prim) {
+		cellRange(primBounds[prim], lo, hi);
+		for (int z = lo.z; z <= hi.z; ++z)
+			for (int y = lo.y; y <= hi.y; ++y)
+				for (int x = lo.x; x <= hi.x; ++x)
+					cellPrims[fill[cellIndex(x, y, z)]++] = prim;
+	}
+}
+
+template <typename F>
+bool uniformGrid::traverse(const ray& r, float& tMax, F&& visitCell) const {
+	if (cellStart.empty()) return false;
+
+	const glm::vec3& origin = r.origin();
+	const glm::vec3& direction = r.direction();
+	const glm::vec3& invDir = r.invDirection();
+	float tEnter = bounds.intersect(r, tMax);
+	if (tEnter == FLT_MAX) return false;
+
+	glm::vec3 entry = origin + tEnter * direction;
+	glm::ivec3 cell = glm::clamp(glm::ivec3((entry - bounds.min) / cellSize), glm::ivec3(0), resolution - 1);
+
+	glm::ivec3 step, out;
+	glm::vec3 tNext, tDelta;
+	for (int axis = 0; axis < 3; ++axis) {
+		if (direction[axis] > 0.0f) {
+			step[axis] = 1;
+			out[axis] = resolution[axis];
+			tNext[axis] = (bounds.min[axis] + (cell[axis] + 1) * cellSize[axis] - origin[axis]) * invDir[axis];
+			tDelta[axis] = cellSize[axis] * invDir[axis];
+		}
+		else if (direction[axis] < 0.0f) {
+			step[axis] = -1;
+			out[axis] = -1;
+			tNext[axis] = (bounds.min[axis] + cell[axis] * cellSize[axis] - origin[axis]) * invDir[axis];
+			tDelta[axis] = -cellSize[axis] * invDir[axis];
+		}
+		else {
+			step[axis] = 0;
+			out[axis] = -1;
+			tNext[axis] = FLT_MAX;
+			tDelta[axis] = FLT_MAX;
+		}
+	}
+
+	for (;;) {
+		int axis = tNext.x < tNext.y ? (tNext.x < tNext.z ? 0 : 2) : (tNext.y < tNext.z ? 1 : 2);
+		float tExit = tNext[axis];
+		if (visitCell(cellIndex(cell.x, cell.y, cell.z))) return true;
+		// Hits found so far may lie in later cells, but nothing beyond this cell can beat one inside it
+		if (tMax <= tExit) return false;
+
+		cell[axis] += step[axis];
+		if (cell[axis] == out[axis]) return false;
+		tNext[axis] += tDelta[axis];
+	}
+}
+
+bool uniformGrid::intersectClosest(const ray& r, float& tMax, const primitiveIntersector& prims) const {
+	mailbox tested;
+	bool hit = false;
+	traverse(r, tMax, [&](int cell) {
+		for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+			int prim = cellPrims[i];
+			if (!tested.seen(prim))
+				hit |= prims.intersect(prim, r, tMax);
+		}
+		return false;
+	});
+	return hit;
+}
+
+bool uniformGrid::intersectAny(const ray& r, float tMax, const primitiveIntersector& prims) const {
+	mailbox tested;
+	return traverse(r, tMax, [&](int cell) {
+		for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+			int prim = cellPrims[i];
+			if (!tested.seen(prim) && prims.occluded(prim, r, tMax)) return true;
+		}
+		return false;
+	});
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include "aabb.h"
+#include "accelerator.h"
+#include "ray.h"
+
+// Uniform grid traversed with a 3D-DDA. Primitives spanning several cells are only tested once per
+// ray thanks to a small per-query mailbox. Suits evenly spread scenes such as particle clouds.
+class uniformGrid : public accelerator
+{
+public:
+	const char* name() const override { return "grid"; }
+
+	void build(const std::vector<aabb>& primBounds) override;
+
+	bool intersectClosest(const ray& r, float& tMax, const primitiveIntersector& prims) const override;
+	bool intersectAny(const ray& r, float tMax, const primitiveIntersector& prims) const override;
+
+	size_t memoryUsage() const override { return cellStart.capacity() * sizeof(int) + cellPrims.capacity() * sizeof(int); }
+
+	// Target number of cells per primitive
+	float density = 2.0f;
+
+private:
+	template <typename F>
+	bool traverse(const ray& r, float& tMax, F&& visitCell) const;
+
+	int cellIndex(int x, int y, int z) const { return (z * resolution.y + y) * resolution.x + x; }
+
+	aabb bounds;
+	glm::ivec3 resolution = glm::ivec3(0);
+	glm::vec3 cellSize;
+	std::vector<int> cellStart;     // Offsets into cellPrims, one past the end for the last cell
+	std::vector<int> cellPrims;
+};
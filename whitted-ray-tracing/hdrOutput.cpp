@@ -0,0 +1,248 @@
+#include "hdrOutput.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "parallel.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HDR_SSE2 1
+#endif
+
+namespace {
+	// Bit patterns used by the conversion below (after Fabian Giesen's float_to_half_fast3_rtne)
+	const uint32_t halfOverflow = (127 + 16) << 23;         // 65536.0f: rounds to infinity and beyond
+	const uint32_t floatInfinity = 255u << 23;
+	const uint32_t halfNormalMin = 113 << 23;               // 2^-14, the smallest normal half
+	const uint32_t denormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+	const uint32_t rebias = (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF;
+
+	uint16_t floatToHalf(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, 4);
+		uint32_t sign = bits & 0x80000000u;
+		bits ^= sign;
+
+		uint32_t half;
+		if (bits >= halfOverflow)
+			half = bits > floatInfinity ? 0x7E00 : 0x7C00;
+		else if (bits < halfNormalMin) {
+			// Adding the magic number lets the FPU shift the mantissa into place and round it
+			float magic, shifted;
+			std::memcpy(&magic, &denormMagic, 4);
+			std::memcpy(&shifted, &bits, 4);
+			shifted += magic;
+			std::memcpy(&half, &shifted, 4);
+			half -= denormMagic;
+		}
+		else {
+			uint32_t mantissaOdd = (bits >> 13) & 1;
+			half = (bits + rebias + mantissaOdd) >> 13;
+		}
+		return static_cast<uint16_t>(half | (sign >> 16));
+	}
+
+	// Little-endian values, as both formats store them
+	void put32(std::vector<unsigned char>& out, uint32_t value) {
+		for (int i = 0; i < 4; ++i)
+			out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+	}
+
+	void putFloat(std::vector<unsigned char>& out, float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, 4);
+		put32(out, bits);
+	}
+
+	void putAttribute(std::vector<unsigned char>& out, const char* name, const char* type, const std::vector<unsigned char>& value) {
+		out.insert(out.end(), name, name + std::strlen(name) + 1);
+		out.insert(out.end(), type, type + std::strlen(type) + 1);
+		put32(out, static_cast<uint32_t>(value.size()));
+		out.insert(out.end(), value.begin(), value.end());
+	}
+
+	bool writeRows(const char* filename, const std::vector<unsigned char>& header, const std::vector<std::vector<unsigned char>>& rows) {
+		std::ofstream file(filename, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+		for (const std::vector<unsigned char>& row : rows)
+			file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+		return static_cast<bool>(file);
+	}
+
+	void toRGBE(const colorRGB& c, unsigned char* rgbe) {
+		double largest = std::fmax(c.r, std::fmax(c.g, c.b));
+		if (!(largest >= 1e-32)) {
+			rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+			return;
+		}
+		int exponent;
+		double scale = std::frexp(largest, &exponent) * 256.0 / largest;
+		rgbe[0] = static_cast<unsigned char>(std::fmax(c.r, 0.0) * scale);
+		rgbe[1] = static_cast<unsigned char>(std::fmax(c.g, 0.0) * scale);
+		rgbe[2] = static_cast<unsigned char>(std::fmax(c.b, 0.0) * scale);
+		rgbe[3] = static_cast<unsigned char>(exponent + 128);
+	}
+
+	// One component of a scanline in Radiance's run-length scheme: a count byte above 128 repeats the next byte
+	// count - 128 times, anything else is followed by that many literal bytes
+	void encodeRuns(const unsigned char* values, int count, std::vector<unsigned char>& out) {
+		const int minRun = 4;
+		int position = 0;
+		while (position < count) {
+			// Find the next run long enough to be worth encoding
+			int runStart = position, runLength = 0;
+			while (runStart < count) {
+				runLength = 1;
+				while (runStart + runLength < count && runLength < 127 && values[runStart + runLength] == values[runStart]) ++runLength;
+				if (runLength >= minRun) break;
+				runStart += runLength;
+			}
+			if (runStart >= count) runLength = 0;
+			// Literals up to it, at most 128 per count byte
+			while (position < runStart) {
+				int literals = runStart - position < 128 ? runStart - position : 128;
+				out.push_back(static_cast<unsigned char>(literals));
+				out.insert(out.end(), values + position, values + position + literals);
+				position += literals;
+			}
+			if (runLength >= minRun) {
+				out.push_back(static_cast<unsigned char>(128 + runLength));
+				out.push_back(values[runStart]);
+				position += runLength;
+			}
+		}
+	}
+}
+
+void floatsToHalves(const float* in, size_t count, uint16_t* out) {
+	size_t i = 0;
+#ifdef HDR_SSE2
+	const __m128i signMask = _mm_set1_epi32(static_cast<int>(0x80000000u));
+	const __m128i overflowBelow = _mm_set1_epi32(static_cast<int>(halfOverflow - 1));
+	const __m128i infinity = _mm_set1_epi32(static_cast<int>(floatInfinity));
+	const __m128i normalMin = _mm_set1_epi32(static_cast<int>(halfNormalMin));
+	const __m128i magicBits = _mm_set1_epi32(static_cast<int>(denormMagic));
+	const __m128i rebias4 = _mm_set1_epi32(static_cast<int>(rebias));
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i quietNaN = _mm_set1_epi32(0x7E00);
+	const __m128i halfInfinity = _mm_set1_epi32(0x7C00);
+	for (; i + 4 <= count; i += 4) {
+		__m128i bits = _mm_castps_si128(_mm_loadu_ps(in + i));
+		__m128i sign = _mm_and_si128(bits, signMask);
+		bits = _mm_xor_si128(bits, sign);
+		// With the sign cleared the bit patterns compare correctly as signed integers
+		__m128i tooLarge = _mm_cmpgt_epi32(bits, overflowBelow);
+		__m128i isNaN = _mm_cmpgt_epi32(bits, infinity);
+		__m128i subnormal = _mm_cmplt_epi32(bits, normalMin);
+
+		__m128i large = _mm_or_si128(_mm_and_si128(isNaN, quietNaN), _mm_andnot_si128(isNaN, halfInfinity));
+		__m128i small = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(magicBits))), magicBits);
+		__m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), one);
+		__m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, rebias4), mantissaOdd), 13);
+
+		__m128i half = _mm_or_si128(_mm_and_si128(subnormal, small), _mm_andnot_si128(subnormal, normal));
+		half = _mm_or_si128(_mm_and_si128(tooLarge, large), _mm_andnot_si128(tooLarge, half));
+		half = _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+		// Sign-extend the low 16 bits so the saturating pack keeps them as they are
+		half = _mm_srai_epi32(_mm_slli_epi32(half, 16), 16);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(half, half));
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = floatToHalf(in[i]);
+}
+
+bool writeRadianceHDR(const char* filename, const std::vector<std::vector<colorRGB>>& pixels) {
+	int height = static_cast<int>(pixels.size());
+	int width = height > 0 ? static_cast<int>(pixels[0].size()) : 0;
+	char text[128];
+	int textSize = std::snprintf(text, sizeof(text), "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", height, width);
+	std::vector<unsigned char> header(text, text + textSize);
+
+	// Scanlines are encoded independently; run-length encoding only exists for widths 8 to 32767
+	bool runLength = width >= 8 && width < 32768;
+	std::vector<std::vector<unsigned char>> rows(height);
+	parallelFor(height, [&](int y, int) {
+		std::vector<unsigned char> rgbe(static_cast<size_t>(width) * 4);
+		for (int x = 0; x < width; ++x)
+			toRGBE(pixels[y][x], &rgbe[x * 4]);
+		std::vector<unsigned char>& row = rows[y];
+		if (!runLength) {
+			row = rgbe;
+			return;
+		}
+		const unsigned char start[4] = { 2, 2, static_cast<unsigned char>(width >> 8), static_cast<unsigned char>(width & 0xFF) };
+		row.assign(start, start + 4);
+		std::vector<unsigned char> component(width);
+		for (int c = 0; c < 4; ++c) {
+			for (int x = 0; x < width; ++x)
+				component[x] = rgbe[x * 4 + c];
+			encodeRuns(component.data(), width, row);
+		}
+	});
+	return writeRows(filename, header, rows);
+}
+
+bool writeEXR(const char* filename, const std::vector<std::vector<colorRGB>>& pixels) {
+	int height = static_cast<int>(pixels.size());
+	int width = height > 0 ? static_cast<int>(pixels[0].size()) : 0;
+	std::vector<unsigned char> header = { 0x76, 0x2F, 0x31, 0x01, 2, 0, 0, 0 };   // Magic number, version 2, single-part scanline
+
+	// Channels are listed, and stored in each scanline, in alphabetical order
+	std::vector<unsigned char> channels;
+	for (const char* name : { "B", "G", "R" }) {
+		channels.push_back(static_cast<unsigned char>(name[0]));
+		channels.push_back(0);
+		put32(channels, 1);         // HALF
+		put32(channels, 0);         // pLinear and reserved bytes
+		put32(channels, 1);         // x sampling
+		put32(channels, 1);         // y sampling
+	}
+	channels.push_back(0);
+	std::vector<unsigned char> window;
+	for (int value : { 0, 0, width - 1, height - 1 })
+		put32(window, static_cast<uint32_t>(value));
+	std::vector<unsigned char> one, zeros;
+	putFloat(one, 1.0f);
+	putFloat(zeros, 0.0f);
+	putFloat(zeros, 0.0f);
+
+	putAttribute(header, "channels", "chlist", channels);
+	putAttribute(header, "compression", "compression", { 0 });     // NO_COMPRESSION
+	putAttribute(header, "dataWindow", "box2i", window);
+	putAttribute(header, "displayWindow", "box2i", window);
+	putAttribute(header, "lineOrder", "lineOrder", { 0 });         // INCREASING_Y
+	putAttribute(header, "pixelAspectRatio", "float", one);
+	putAttribute(header, "screenWindowCenter", "v2f", zeros);
+	putAttribute(header, "screenWindowWidth", "float", one);
+	header.push_back(0);
+
+	// Offset table: where each scanline block starts in the file
+	size_t blockSize = 8 + static_cast<size_t>(width) * 3 * 2;
+	uint64_t offset = header.size() + static_cast<size_t>(height) * 8;
+	for (int y = 0; y < height; ++y, offset += blockSize) {
+		put32(header, static_cast<uint32_t>(offset));
+		put32(header, static_cast<uint32_t>(offset >> 32));
+	}
+
+	std::vector<std::vector<unsigned char>> rows(height);
+	parallelFor(height, [&](int y, int) {
+		std::vector<float> planes(static_cast<size_t>(width) * 3);
+		for (int x = 0; x < width; ++x) {
+			planes[x] = static_cast<float>(pixels[y][x].b);
+			planes[width + x] = static_cast<float>(pixels[y][x].g);
+			planes[2 * width + x] = static_cast<float>(pixels[y][x].r);
+		}
+		std::vector<uint16_t> halves(planes.size());
+		floatsToHalves(planes.data(), planes.size(), halves.data());
+
+		std::vector<unsigned char>& row = rows[y];
+		row.reserve(blockSize);
+		put32(row, static_cast<uint32_t>(y));
+		put32(row, static_cast<uint32_t>(halves.size() * 2));
+		// Every target this builds for is little-endian, so the halves go out as they are in memory
+		row.resize(blockSize);
+		std::memcpy(row.data() + 8, halves.data(), halves.size() * 2);
+	});
+	return writeRows(filename, header, rows);
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "colorRGB.h"
+
+// Converts floats to IEEE half precision, rounding to nearest even. Values beyond the half range become
+// infinity, NaN stays NaN. Four at a time with SSE2 where available
+void floatsToHalves(const float* in, size_t count, uint16_t* out);
+
+// Radiance RGBE (.hdr): a shared 8-bit exponent per pixel, each scanline run-length encoded per component.
+// Writes the unclamped framebuffer, so no tonemapping applies
+bool writeRadianceHDR(const char* filename, const std::vector<std::vector<colorRGB>>& pixels);
+
+// OpenEXR scanline image with half-float R, G and B channels and no compression, one scanline per block
+bool writeEXR(const char* filename, const std::vector<std::vector<colorRGB>>& pixels);
@@ -0,0 +1,20 @@
+#pragma once
+#include "glm/glm.hpp"
+
+// What traversal records about the closest hit so far. Only the distance, the primitive and its
+// barycentrics are kept; everything else is derived once for the final hit by scene::computeSurfaceInteraction
+struct HitInfo {
+    bool hit = false;
+    float t;
+    int object = -1;    // Index of the scene object that was hit
+    int primitive = -1; // Triangle within the object's mesh, -1 for spheres
+    float u = 0.0f;     // Barycentric coordinates on the triangle
+    float v = 0.0f;
+};
+
+// Geometry and material at a hit point, as needed for shading
+struct surfaceInteraction {
+    glm::vec3 point;
+    glm::vec3 normal;   // Geometric normal in world space, facing out of the object
+    int material = 0;   // Index into scene::materials
+};
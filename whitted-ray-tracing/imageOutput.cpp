@@ -0,0 +1,93 @@
+#include "imageOutput.h"
+#include <cstdio>
+#include <cstring>
+#include "pngEncoder.h"
+#include "qoiEncoder.h"
+
+namespace {
+	int formatHeader(char* header, size_t size, ppmFormat format, int width, int height) {
+		return std::snprintf(header, size, "%s\n%d %d\n255\n", format == ppmFormat::binary ? "P6" : "P3", width, height);
+	}
+
+	bool writeBytes(const char* filename, const std::vector<unsigned char>& bytes) {
+		std::ofstream file(filename, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		return static_cast<bool>(file);
+	}
+
+	void writeASCII(std::ostream& file, const unsigned char* levels, size_t pixelCount) {
+		for (size_t i = 0; i < pixelCount; ++i, levels += 3)
+			file << static_cast<int>(levels[0]) << ' ' << static_cast<int>(levels[1]) << ' ' << static_cast<int>(levels[2]) << '\n';
+	}
+}
+
+bool writePPM(const char* filename, const std::vector<std::vector<colorRGB>>& pixels, ppmFormat format, const tonemapSettings& tonemap) {
+	int height = static_cast<int>(pixels.size());
+	int width = height > 0 ? static_cast<int>(pixels[0].size()) : 0;
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) return false;
+
+	// The header goes in front of the pixels so a binary file is one write
+	char header[64];
+	int headerSize = formatHeader(header, sizeof(header), format, width, height);
+	std::vector<unsigned char> buffer(headerSize + static_cast<size_t>(width) * height * 3);
+	std::memcpy(buffer.data(), header, headerSize);
+	quantizeImage(pixels, tonemap, buffer.data() + headerSize);
+	if (format == ppmFormat::binary)
+		file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+	else {
+		file.write(header, headerSize);
+		writeASCII(file, buffer.data() + headerSize, static_cast<size_t>(width) * height);
+	}
+	return static_cast<bool>(file);
+}
+
+bool writePNG(const char* filename, const std::vector<std::vector<colorRGB>>& pixels, const tonemapSettings& tonemap) {
+	int height = static_cast<int>(pixels.size());
+	int width = height > 0 ? static_cast<int>(pixels[0].size()) : 0;
+	std::vector<unsigned char> levels(static_cast<size_t>(width) * height * 3);
+	quantizeImage(pixels, tonemap, levels.data());
+	std::vector<unsigned char> encoded;
+	encodePNG(levels.data(), width, height, tonemap.srgb, encoded);
+	return writeBytes(filename, encoded);
+}
+
+bool writeQOI(const char* filename, const std::vector<std::vector<colorRGB>>& pixels, const tonemapSettings& tonemap) {
+	int height = static_cast<int>(pixels.size());
+	int width = height > 0 ? static_cast<int>(pixels[0].size()) : 0;
+	std::vector<unsigned char> levels(static_cast<size_t>(width) * height * 3);
+	quantizeImage(pixels, tonemap, levels.data());
+	std::vector<unsigned char> encoded;
+	encodeQOI(levels.data(), width, height, tonemap.srgb, encoded);
+	return writeBytes(filename, encoded);
+}
+
+ppmStreamWriter::ppmStreamWriter(const char* filename, int width, int height, ppmFormat format, const tonemapSettings& tonemap)
+	: file(filename, std::ios::binary), width(width), height(height), format(format), tonemap(tonemap) {
+	char header[64];
+	file.write(header, formatHeader(header, sizeof(header), format, width, height));
+}
+
+bool ppmStreamWriter::writeRows(int first, int count, const colorRGB* rows) {
+	if (!file || first != rowsWritten) return false;
+	levels.resize(static_cast<size_t>(width) * count * 3);
+	quantizeRows(rows, width, count, tonemap, levels.data());
+	if (format == ppmFormat::binary)
+		file.write(reinterpret_cast<const char*>(levels.data()), static_cast<std::streamsize>(levels.size()));
+	else
+		writeASCII(file, levels.data(), static_cast<size_t>(width) * count);
+	rowsWritten += count;
+	return static_cast<bool>(file);
+}
+
+bool ppmStreamWriter::finish() {
+	file.close();
+	return !file.fail() && rowsWritten == height;
+}
+
+bool parsePPMFormat(const char* name, ppmFormat& format) {
+	if (std::strcmp(name, "p3") == 0) format = ppmFormat::ascii;
+	else if (std::strcmp(name, "p6") == 0) format = ppmFormat::binary;
+	else return false;
+	return true;
+}
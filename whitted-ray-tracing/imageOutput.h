@@ -0,0 +1,44 @@
+#pragma once
+#include <fstream>
+#include <vector>
+#include "colorRGB.h"
+#include "scanlineSink.h"
+#include "tonemap.h"
+
+enum class ppmFormat {
+	ascii,      // P3: decimal values as text
+	binary,     // P6: one byte per channel
+};
+
+// Writes rows of equal width as a PPM with 8-bit channels converted by quantizeImage. The binary format quantizes
+// the whole image into a single buffer and hands it to one write. Returns false if the file could not be written
+bool writePPM(const char* filename, const std::vector<std::vector<colorRGB>>& pixels, ppmFormat format,
+	const tonemapSettings& tonemap = tonemapSettings());
+
+// Lossless compressed 8-bit output, tonemapped like writePPM. The PNG's deflate runs in parallel over row chunks
+bool writePNG(const char* filename, const std::vector<std::vector<colorRGB>>& pixels, const tonemapSettings& tonemap = tonemapSettings());
+bool writeQOI(const char* filename, const std::vector<std::vector<colorRGB>>& pixels, const tonemapSettings& tonemap = tonemapSettings());
+
+// Writes a PPM band by band as a streaming render hands over its scanlines, holding only the current band's
+// bytes. The header goes out when the file is opened
+class ppmStreamWriter : public scanlineSink
+{
+public:
+	ppmStreamWriter(const char* filename, int width, int height, ppmFormat format, const tonemapSettings& tonemap = tonemapSettings());
+
+	bool writeRows(int first, int count, const colorRGB* rows) override;
+	// Closes the file. Returns false if any write failed or the frame did not arrive in full
+	bool finish();
+
+private:
+	std::ofstream file;
+	int width;
+	int height;
+	ppmFormat format;
+	tonemapSettings tonemap;
+	int rowsWritten = 0;
+	std::vector<unsigned char> levels;
+};
+
+// Parses "p3" or "p6". Returns false for anything else
+bool parsePPMFormat(const char* name, ppmFormat& format);
@@ -0,0 +1,42 @@
+#pragma once
+#include "glm/glm.hpp"
+#include "aabb.h"
+#include "ray.h"
+
+// Places a mesh in the scene with an affine transform. Only the transform is stored per instance,
+// the geometry and its bottom-level BVH are shared through meshIndex.
+class instance
+{
+public:
+	instance(int meshIndex, const glm::mat4x3& objectToWorld, int material = 0) : meshIndex(meshIndex), material(material) { setTransform(objectToWorld); }
+
+	void setTransform(const glm::mat4x3& transform) {
+		objectToWorld = transform;
+		worldToObject = glm::mat4x3(glm::inverse(glm::mat4(transform)));
+	}
+
+	// Moves a world space ray into object space. The direction is not renormalized, so hit distances
+	// and the ray's interval stay valid in world space as well
+	ray toObject(const ray& r) const {
+		return ray(worldToObject * glm::vec4(r.origin(), 1.0f), worldToObject * glm::vec4(r.direction(), 0.0f), r.tMin(), r.tMax());
+	}
+
+	glm::vec3 pointToWorld(const glm::vec3& p) const { return objectToWorld * glm::vec4(p, 1.0f); }
+	// Normals go through the inverse transpose to stay perpendicular under non-uniform scaling
+	glm::vec3 normalToWorld(const glm::vec3& n) const { return glm::normalize(glm::transpose(glm::mat3(worldToObject)) * n); }
+
+	// Transforms the box's center and takes the extent along each world axis from the absolute values of the
+	// matrix (Arvo), which gives the same box as transforming all eight corners for a fraction of the work
+	aabb worldBounds(const aabb& objectBounds) const {
+		glm::vec3 center = pointToWorld(objectBounds.centroid());
+		glm::vec3 halfSize = 0.5f * (objectBounds.max - objectBounds.min);
+		glm::mat3 linear(objectToWorld);
+		glm::vec3 extent = glm::abs(linear[0]) * halfSize.x + glm::abs(linear[1]) * halfSize.y + glm::abs(linear[2]) * halfSize.z;
+		return aabb(center - extent, center + extent);
+	}
+
+	int meshIndex;
+	int material;   // Index into scene::materials
+	glm::mat4x3 objectToWorld;
+	glm::mat4x3 worldToObject;
+};
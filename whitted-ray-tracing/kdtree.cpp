@@ -0,0 +1,216 @@
+#include "kdtree.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+	constexpr float traversalCost = 1.0f;
+	constexpr float intersectCost = 2.0f;
+	constexpr float emptyBonus = 0.2f;
+	// Nodes with more primitives than this evaluate binned split candidates instead of every primitive edge
+	constexpr int exactSplitLimit = 256;
+	constexpr int binCount = 64;
+	// Entries in the traversal stack; a ray defers at most one node per level, so the depth stays below it
+	constexpr int traversalStackSize = 64;
+
+	struct stackEntry {
+		int node;
+		float tMin;
+		float tMax;
+	};
+}
+
+void kdTree::build(const std::vector<aabb>& primBounds) {
+	nodes.clear();
+	primIndices.clear();
+	bounds = aabb();
+	for (const aabb& b : primBounds)
+		bounds.expand(b);
+	if (primBounds.empty()) return;
+
+	std::vector<int> prims(primBounds.size());
+	for (int i = 0; i < static_cast<int>(prims.size()); ++i)
+		prims[i] = i;
+
+	int maxDepth = std::min(static_cast<int>(8 + 1.3f * std::log2(static_cast<float>(primBounds.size()))), traversalStackSize - 1);
+	nodes.push_back(kdNode());
+	subdivide(0, bounds, prims, primBounds, maxDepth);
+}
+
+void kdTree::subdivide(int nodeIndex, const aabb& nodeBounds, std::vector<int>& prims, const std::vector<aabb>& primBounds, int depth) {
+	int count = static_cast<int>(prims.size());
+	float leafCost = intersectCost * count;
+
+	int bestAxis = -1;
+	float bestSplit = 0.0f;
+	float bestCost = FLT_MAX;
+	if (count > 1 && depth > 0) {
+		float invArea = 1.0f / nodeBounds.surfaceArea();
+		std::vector<float> mins(count), maxs(count);
+		for (int axis = 0; axis < 3; ++axis) {
+			float lo = nodeBounds.min[axis];
+			float hi = nodeBounds.max[axis];
+			if (hi <= lo) continue;
+
+			auto evaluate = [&](float split, int below, int above) {
+				aabb belowBox = nodeBounds, aboveBox = nodeBounds;
+				belowBox.max[axis] = split;
+				aboveBox.min[axis] = split;
+				float bonus = (below == 0 || above == 0) ? emptyBonus : 0.0f;
+				float cost = traversalCost + intersectCost * (1.0f - bonus) *
+					(belowBox.surfaceArea() * below + aboveBox.surfaceArea() * above) * invArea;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			};
+
+			if (count > exactSplitLimit) {
+				// Histogram the clipped primitive edges; prefix sums give the side counts at every bin boundary
+				int minBins[binCount] = {}, maxBins[binCount] = {};
+				float scale = binCount / (hi - lo);
+				for (int prim : prims) {
+					minBins[glm::clamp(static_cast<int>((primBounds[prim].min[axis] - lo) * scale), 0, binCount - 1)]++;
+					maxBins[glm::clamp(static_cast<int>((primBounds[prim].max[axis] - lo) * scale), 0, binCount - 1)]++;
+				}
+				int below = 0, above = count;
+				for (int b = 1; b < binCount; ++b) {
+					below += minBins[b - 1];
+					above -= maxBins[b - 1];
+					evaluate(lo + b / scale, below, above);
+				}
+				continue;
+			}
+
+			// Candidate planes are the primitive bounds clipped to this node; counts come from the sorted edges
+			for (int i = 0; i < count; ++i) {
+				mins[i] = glm::max(primBounds[prims[i]].min[axis], lo);
+				maxs[i] = glm::min(primBounds[prims[i]].max[axis], hi);
+			}
+			std::sort(mins.begin(), mins.end());
+			std::sort(maxs.begin(), maxs.end());
+
+			auto evaluateEdge = [&](float split) {
+				if (split <= lo || split >= hi) return;
+				int below = static_cast<int>(std::lower_bound(mins.begin(), mins.end(), split) - mins.begin());
+				int above = count - static_cast<int>(std::upper_bound(maxs.begin(), maxs.end(), split) - maxs.begin());
+				evaluate(split, below, above);
+			};
+			for (int i = 0; i < count; ++i) {
+				if (i == 0 || mins[i] != mins[i - 1]) evaluateEdge(mins[i]);
+				if (i == 0 || maxs[i] != maxs[i - 1]) evaluateEdge(maxs[i]);
+			}
+		}
+	}
+
+	if (bestAxis < 0 || bestCost >= leafCost) {
+		kdNode& leaf = nodes[nodeIndex];
+		leaf.axis = 3;
+		leaf.split = 0.0f;
+		leaf.child = static_cast<int>(primIndices.size());
+		leaf.count = count;
+		primIndices.insert(primIndices.end(), prims.begin(), prims.end());
+		return;
+	}
+
+	// Straddling primitives go to both sides; ones lying flat in the plane go below
+	std::vector<int> below, above;
+	for (int prim : prims) {
+		const aabb& b = primBounds[prim];
+		bool inBelow = b.min[bestAxis] < bestSplit;
+		bool inAbove = b.max[bestAxis] > bestSplit;
+		if (inBelow || !inAbove) below.push_back(prim);
+		if (inAbove) above.push_back(prim);
+	}
+	prims.clear();
+	prims.shrink_to_fit();
+
+	int child = static_cast<int>(nodes.size());
+	kdNode& node = nodes[nodeIndex];
+	node.axis = bestAxis;
+	node.split = bestSplit;
+	node.child = child;
+	node.count = 0;
+	nodes.push_back(kdNode());
+	nodes.push_back(kdNode());
+
+	aabb belowBox = nodeBounds, aboveBox = nodeBounds;
+	belowBox.max[bestAxis] = bestSplit;
+	aboveBox.min[bestAxis] = bestSplit;
+	subdivide(child, belowBox, below, primBounds, depth - 1);
+	subdivide(child + 1, aboveBox, above, primBounds, depth - 1);
+}
+
+template <typename F>
+bool kdTree::traverse(const ray& r, float& tMax, F&& visitLeaf) const {
+	if (nodes.empty()) return false;
+
+	const glm::vec3& origin = r.origin();
+	const glm::vec3& direction = r.direction();
+	const glm::vec3& invDir = r.invDirection();
+	glm::vec3 t0 = (bounds.min - origin) * invDir;
+	glm::vec3 t1 = (bounds.max - origin) * invDir;
+	glm::vec3 tNear = glm::min(t0, t1);
+	glm::vec3 tFar = glm::max(t0, t1);
+	float tMin = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+	float tNodeMax = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+	if (tMin > tNodeMax) return false;
+
+	stackEntry stack[traversalStackSize];
+	int stackSize = 0;
+	int nodeIndex = 0;
+	for (;;) {
+		// Descend front to back until reaching a leaf, deferring the far side of every split the ray crosses
+		const kdNode* node = &nodes[nodeIndex];
+		while (!node->isLeaf()) {
+			int axis = node->axis;
+			float tSplit = direction[axis] != 0.0f ? (node->split - origin[axis]) * invDir[axis] : FLT_MAX;
+			bool belowFirst = origin[axis] < node->split || (origin[axis] == node->split && (r.negative(axis) || direction[axis] == 0.0f));
+			int first = belowFirst ? node->child : node->child + 1;
+			int second = belowFirst ? node->child + 1 : node->child;
+
+			if (tSplit > tNodeMax || tSplit <= 0.0f)
+				nodeIndex = first;
+			else if (tSplit < tMin)
+				nodeIndex = second;
+			else {
+				assert(stackSize < traversalStackSize);
+				stack[stackSize++] = { second, tSplit, tNodeMax };
+				nodeIndex = first;
+				tNodeMax = tSplit;
+			}
+			node = &nodes[nodeIndex];
+		}
+
+		if (visitLeaf(*node)) return true;
+		// A hit inside this node's span is closer than anything left on the stack
+		if (tMax <= tNodeMax) return false;
+
+		do {
+			if (stackSize == 0) return false;
+			--stackSize;
+			nodeIndex = stack[stackSize].node;
+			tMin = stack[stackSize].tMin;
+			tNodeMax = stack[stackSize].tMax;
+		} while (tMin > tMax);
+	}
+}
+
+bool kdTree::intersectClosest(const ray& r, float& tMax, const primitiveIntersector& prims) const {
+	bool hit = false;
+	traverse(r, tMax, [&](const kdNode& leaf) {
+		for (int i = leaf.child; i < leaf.child + leaf.count; ++i)
+			hit |= prims.intersect(primIndices[i], r, tMax);
+		return false;
+	});
+	return hit;
+}
+
+bool kdTree::intersectAny(const ray& r, float tMax, const primitiveIntersector& prims) const {
+	return traverse(r, tMax, [&](const kdNode& leaf) {
+		for (int i = leaf.child; i < leaf.child + leaf.count; ++i)
+			if (prims.occluded(primIndices[i], r, tMax)) return true;
+		return false;
+	});
+}
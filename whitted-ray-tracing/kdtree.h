@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include "aabb.h"
+#include "accelerator.h"
+#include "ray.h"
+
+struct kdNode {
+	float split;
+	int axis;       // Split axis, or 3 for leaves
+	int child;      // Index of the child below the split plane for interior nodes (the other one follows it), first entry in primIndices for leaves
+	int count;      // Number of primitives in a leaf
+
+	bool isLeaf() const { return axis == 3; }
+};
+
+// Kd-tree built with the surface area heuristic over the primitive bounds. Primitives straddling a split
+// plane are referenced from both sides. Tends to do well on axis-aligned, architectural scenes.
+class kdTree : public accelerator
+{
+public:
+	const char* name() const override { return "kdtree"; }
+
+	void build(const std::vector<aabb>& primBounds) override;
+
+	bool intersectClosest(const ray& r, float& tMax, const primitiveIntersector& prims) const override;
+	bool intersectAny(const ray& r, float tMax, const primitiveIntersector& prims) const override;
+
+	size_t memoryUsage() const override { return nodes.capacity() * sizeof(kdNode) + primIndices.capacity() * sizeof(int); }
+
+private:
+	void subdivide(int nodeIndex, const aabb& nodeBounds, std::vector<int>& prims, const std::vector<aabb>& primBounds, int depth);
+
+	template <typename F>
+	bool traverse(const ray& r, float& tMax, F&& visitLeaf) const;
+
+	aabb bounds;
+	std::vector<kdNode> nodes;
+	std::vector<int> primIndices;
+};
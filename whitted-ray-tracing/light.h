@@ -0,0 +1,14 @@
+#pragma once
+#include <cfloat>
+#include "glm/glm.hpp"
+#include "colorRGB.h"
+
+struct light {
+	glm::vec3 position;
+	colorRGB intensity;
+	// Distance at which the light has dropped to half its intensity. FLT_MAX keeps it constant at any distance
+	float range = FLT_MAX;
+
+	// Falloff factor for a point at the given squared distance
+	float attenuation(float distanceSquared) const { return 1.0f / (1.0f + distanceSquared / (range * range)); }
+};
@@ -0,0 +1,41 @@
+#include "lightTree.h"
+
+void lightTree::build(const std::vector<light>& lights) {
+	size_t count = lights.size();
+	positions.resize(count);
+	power.resize(count);
+	range.resize(count);
+	std::vector<aabb> bounds(count);
+	for (size_t i = 0; i < count; ++i) {
+		const light& l = lights[i];
+		positions[i] = l.position;
+		power[i] = static_cast<float>(glm::max(l.intensity.r, glm::max(l.intensity.g, l.intensity.b)));
+		range[i] = l.range;
+		bounds[i] = aabb(l.position, l.position);
+	}
+	tree.build(bounds);
+
+	// Children always come after their parent, so a reverse sweep sees both before the node itself
+	size_t nodeCount = tree.nodes.size();
+	nodePower.assign(nodeCount, 0.0f);
+	nodeRange.assign(nodeCount, 0.0f);
+	nodeLights.assign(nodeCount, 0);
+	for (size_t n = nodeCount; n-- > 0;) {
+		const bvhNode& node = tree.nodes[n];
+		if (node.isLeaf()) {
+			for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+				int index = tree.primIndices[i];
+				nodePower[n] += power[index];
+				nodeRange[n] = glm::max(nodeRange[n], range[index]);
+			}
+			nodeLights[n] = node.count;
+		}
+		else {
+			for (int child = node.leftFirst; child <= node.leftFirst + 1; ++child) {
+				nodePower[n] += nodePower[child];
+				nodeRange[n] = glm::max(nodeRange[n], nodeRange[child]);
+				nodeLights[n] += nodeLights[child];
+			}
+		}
+	}
+}
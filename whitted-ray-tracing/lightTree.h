@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include "bvh.h"
+#include "light.h"
+
+// BVH over the point lights of a scene. Each node also bounds the light it can deliver, so shading can skip
+// whole groups of lights that are too far, too dim or below the horizon before casting any shadow ray
+class lightTree
+{
+public:
+	void build(const std::vector<light>& lights);
+
+	// Calls visit(index) for every light that may deliver at least threshold (largest channel, before the
+	// cosine) to point p on a surface facing normal. Returns how many lights were culled
+	template <typename F>
+	int query(const glm::vec3& p, const glm::vec3& normal, float threshold, F&& visit) const;
+
+	bool empty() const { return tree.empty(); }
+
+private:
+	// Upper bound on the attenuated power reaching p from anything inside box
+	static float bound(const aabb& box, float power, float range, const glm::vec3& p) {
+		glm::vec3 nearest = glm::clamp(p, box.min, box.max);
+		glm::vec3 d = nearest - p;
+		return power / (1.0f + glm::dot(d, d) / (range * range));
+	}
+
+	bvh tree;
+	// Per node: summed largest channel of its lights' intensities, their largest range and their count
+	std::vector<float> nodePower;
+	std::vector<float> nodeRange;
+	std::vector<int> nodeLights;
+	// Per light, the same in light order
+	std::vector<glm::vec3> positions;
+	std::vector<float> power;
+	std::vector<float> range;
+};
+
+template <typename F>
+int lightTree::query(const glm::vec3& p, const glm::vec3& normal, float threshold, F&& visit) const {
+	if (tree.empty()) return 0;
+
+	int culled = 0;
+	int stack[bvhStackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		int nodeIndex = stack[--stackSize];
+		const bvhNode& node = tree.nodes[nodeIndex];
+
+		// Skip nodes entirely behind the surface, or too weak even at their closest point
+		glm::vec3 farthest(normal.x > 0.0f ? node.bounds.max.x : node.bounds.min.x,
+			normal.y > 0.0f ? node.bounds.max.y : node.bounds.min.y,
+			normal.z > 0.0f ? node.bounds.max.z : node.bounds.min.z);
+		if (glm::dot(farthest - p, normal) <= 0.0f || bound(node.bounds, nodePower[nodeIndex], nodeRange[nodeIndex], p) < threshold) {
+			culled += nodeLights[nodeIndex];
+			continue;
+		}
+
+		if (!node.isLeaf()) {
+			assert(stackSize + 2 <= bvhStackSize);
+			stack[stackSize++] = node.leftFirst + 1;
+			stack[stackSize++] = node.leftFirst;
+			continue;
+		}
+		for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+			int index = tree.primIndices[i];
+			glm::vec3 d = positions[index] - p;
+			if (power[index] / (1.0f + glm::dot(d, d) / (range[index] * range[index])) < threshold)
+				++culled;
+			else
+				visit(index);
+		}
+	}
+	return culled;
+}
@@ -0,0 +1,71 @@
+#include "mappedImage.h"
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool mappedPPM::create(const char* filename, int imageWidth, int imageHeight) {
+	close();
+	char header[64];
+	int headerSize = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", imageWidth, imageHeight);
+	size = headerSize + static_cast<size_t>(imageWidth) * imageHeight * 3;
+	width = imageWidth;
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+	file = handle;
+	// Mapping with an explicit size grows the file to it
+	ULARGE_INTEGER mappedSize;
+	mappedSize.QuadPart = size;
+	fileMapping = CreateFileMappingA(handle, nullptr, PAGE_READWRITE, mappedSize.HighPart, mappedSize.LowPart, nullptr);
+	if (fileMapping)
+		mapping = static_cast<unsigned char*>(MapViewOfFile(fileMapping, FILE_MAP_WRITE, 0, 0, size));
+#else
+	file = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) return false;
+	if (ftruncate(file, static_cast<off_t>(size)) == 0) {
+		void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+		if (address != MAP_FAILED)
+			mapping = static_cast<unsigned char*>(address);
+	}
+#endif
+	if (!mapping) {
+		close();
+		return false;
+	}
+	std::memcpy(mapping, header, headerSize);
+	pixels = mapping + headerSize;
+	return true;
+}
+
+bool mappedPPM::close() {
+	bool flushed = true;
+#ifdef _WIN32
+	if (mapping) {
+		flushed = FlushViewOfFile(mapping, 0) && FlushFileBuffers(file);
+		UnmapViewOfFile(mapping);
+	}
+	if (fileMapping) CloseHandle(fileMapping);
+	if (file) CloseHandle(file);
+	fileMapping = nullptr;
+	file = nullptr;
+#else
+	if (mapping) {
+		flushed = msync(mapping, size, MS_SYNC) == 0;
+		munmap(mapping, size);
+	}
+	if (file >= 0) flushed = ::close(file) == 0 && flushed;
+	file = -1;
+#endif
+	mapping = pixels = nullptr;
+	size = 0;
+	return flushed;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+// A binary PPM created at its final size and mapped into memory, so render threads can quantize finished
+// scanlines straight into their place in the file. The header is filled in by create()
+class mappedPPM
+{
+public:
+	mappedPPM() {}
+	~mappedPPM() { close(); }
+	mappedPPM(const mappedPPM&) = delete;
+	mappedPPM& operator=(const mappedPPM&) = delete;
+
+	// Creates (or truncates) the file, sizes it for the whole image and maps it. Returns false on failure
+	bool create(const char* filename, int width, int height);
+
+	// The 3 * width bytes of scanline y. Threads may fill different scanlines concurrently
+	unsigned char* row(int y) { return pixels + static_cast<size_t>(y) * width * 3; }
+
+	// Writes the mapping back with msync (FlushViewOfFile on Windows), waiting until it reached the disk, then
+	// unmaps and closes the file. Returns false if the data could not be flushed
+	bool close();
+
+private:
+	unsigned char* mapping = nullptr;
+	unsigned char* pixels = nullptr;
+	size_t size = 0;
+	int width = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* fileMapping = nullptr;
+#else
+	int file = -1;
+#endif
+};
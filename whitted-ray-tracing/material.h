@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include "colorRGB.h"
+
+// Whitted-style surface description: local Phong shading plus mirror reflection and refraction coefficients
+struct material {
+	colorRGB diffuse = colorRGB(0.8, 0.8, 0.8);
+	colorRGB specular = colorRGB(0.0, 0.0, 0.0);
+	float shininess = 32.0f;
+	float reflectivity = 0.0f;
+	float transmissivity = 0.0f;
+	float ior = 1.5f;
+};
+
+// Optional shading terms. Each material's combination selects a shading kernel compiled for exactly those terms
+enum materialFeatures : unsigned {
+	specularFeature = 1 << 0,       // Phong highlight
+	reflectionFeature = 1 << 1,     // Mirror reflection rays
+	refractionFeature = 1 << 2,     // Transmitted rays, with total internal reflection
+	allFeatures = specularFeature | reflectionFeature | refractionFeature,
+};
+
+// All materials of a scene as parallel arrays indexed by material id, so shading kernels stream only the
+// parameters they use
+class materialTable
+{
+public:
+	// Appends a material and returns its id
+	int add(const material& m) {
+		diffuse.push_back(m.diffuse);
+		specular.push_back(m.specular);
+		shininess.push_back(m.shininess);
+		reflectivity.push_back(m.reflectivity);
+		transmissivity.push_back(m.transmissivity);
+		ior.push_back(m.ior);
+		features.push_back((m.specular.r > 0.0 || m.specular.g > 0.0 || m.specular.b > 0.0 ? specularFeature : 0u)
+			| (m.reflectivity > 0.0f ? reflectionFeature : 0u) | (m.transmissivity > 0.0f ? refractionFeature : 0u));
+		usedFeatures |= features.back();
+		return static_cast<int>(size()) - 1;
+	}
+
+	material get(int id) const {
+		material m;
+		m.diffuse = diffuse[id];
+		m.specular = specular[id];
+		m.shininess = shininess[id];
+		m.reflectivity = reflectivity[id];
+		m.transmissivity = transmissivity[id];
+		m.ior = ior[id];
+		return m;
+	}
+
+	size_t size() const { return diffuse.size(); }
+	bool empty() const { return diffuse.empty(); }
+
+	std::vector<colorRGB> diffuse;
+	std::vector<colorRGB> specular;
+	std::vector<float> shininess;
+	std::vector<float> reflectivity;
+	std::vector<float> transmissivity;
+	std::vector<float> ior;
+	std::vector<unsigned> features;     // materialFeatures the material needs, fixed when it is added
+	unsigned usedFeatures = 0;          // Union of features over all materials
+};
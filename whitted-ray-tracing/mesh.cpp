@@ -0,0 +1,90 @@
+#include "mesh.h"
+
+namespace {
+	// Moller-Trumbore ray/triangle test
+	bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+		float tMin, float tMax, float& t, float& u, float& v) {
+		glm::vec3 edge1 = v1 - v0;
+		glm::vec3 edge2 = v2 - v0;
+		glm::vec3 p = glm::cross(direction, edge2);
+		float det = glm::dot(edge1, p);
+		if (glm::abs(det) < 1e-12f) return false;
+
+		float invDet = 1.0f / det;
+		glm::vec3 s = origin - v0;
+		u = glm::dot(s, p) * invDet;
+		if (u < 0.0f || u > 1.0f) return false;
+
+		glm::vec3 q = glm::cross(s, edge1);
+		v = glm::dot(direction, q) * invDet;
+		if (v < 0.0f || u + v > 1.0f) return false;
+
+		t = glm::dot(edge2, q) * invDet;
+		return t > tMin && t < tMax;
+	}
+}
+
+void mesh::gatherBounds() {
+	triangleBounds.resize(triangles.size());
+	for (size_t i = 0; i < triangles.size(); ++i) {
+		aabb box;
+		box.expand(vertices[triangles[i].x]);
+		box.expand(vertices[triangles[i].y]);
+		box.expand(vertices[triangles[i].z]);
+		triangleBounds[i] = box;
+	}
+}
+
+void mesh::build() {
+	gatherBounds();
+	blas.build(triangleBounds);
+}
+
+void mesh::refit() {
+	gatherBounds();
+	blas.refit(triangleBounds);
+}
+
+bool mesh::intersect(const ray& r, float tMin, float& tMax, int& triangle, float& u, float& v) const {
+	glm::vec3 origin = r.origin();
+	glm::vec3 direction = r.direction();
+	return blas.intersect(r, tMax, [&](int index, float& tClosest) {
+		const glm::ivec3& tri = triangles[index];
+		float t, hitU, hitV;
+		if (!intersectTriangle(origin, direction, vertices[tri.x], vertices[tri.y], vertices[tri.z], tMin, tClosest, t, hitU, hitV))
+			return false;
+		tClosest = t;
+		triangle = index;
+		u = hitU;
+		v = hitV;
+		return true;
+	});
+}
+
+bool mesh::occluded(const ray& r, float tMin, float tMax) const {
+	glm::vec3 origin = r.origin();
+	glm::vec3 direction = r.direction();
+	return blas.occluded(r, tMax, [&](int index) {
+		const glm::ivec3& tri = triangles[index];
+		float t, u, v;
+		return intersectTriangle(origin, direction, vertices[tri.x], vertices[tri.y], vertices[tri.z], tMin, tMax, t, u, v);
+	});
+}
+
+int mesh::crossings(const ray& r, float tMin, float tMax) const {
+	glm::vec3 origin = r.origin();
+	glm::vec3 direction = r.direction();
+	int count = 0;
+	blas.occluded(r, tMax, [&](int index) {
+		const glm::ivec3& tri = triangles[index];
+		float t, u, v;
+		count += intersectTriangle(origin, direction, vertices[tri.x], vertices[tri.y], vertices[tri.z], tMin, tMax, t, u, v);
+		return false;
+	});
+	return count;
+}
+
+glm::vec3 mesh::normal(int triangle) const {
+	const glm::ivec3& tri = triangles[triangle];
+	return glm::normalize(glm::cross(vertices[tri.y] - vertices[tri.x], vertices[tri.z] - vertices[tri.x]));
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include "glm/glm.hpp"
+#include "aabb.h"
+#include "bvh.h"
+#include "ray.h"
+
+// Triangle mesh with its own bottom-level BVH in object space. Shared by every instance placing it in the scene
+class mesh
+{
+public:
+	// Builds the bottom-level BVH; call after changing the triangles
+	void build();
+	// Refits the bottom-level BVH after vertices moved without changing the triangles
+	void refit();
+
+	aabb bounds() const { return blas.empty() ? aabb() : blas.nodes[0].bounds; }
+
+	// Finds the nearest triangle hit with t in (tMin, tMax), shrinking tMax on a hit
+	bool intersect(const ray& r, float tMin, float& tMax, int& triangle, float& u, float& v) const;
+
+	// Returns as soon as any triangle blocks the ray in (tMin, tMax); no barycentrics or triangle index are kept
+	bool occluded(const ray& r, float tMin, float tMax) const;
+
+	// Counts the triangles the ray passes through in (tMin, tMax), visiting every one the BVH can't rule out
+	int crossings(const ray& r, float tMin, float tMax) const;
+
+	glm::vec3 normal(int triangle) const;
+
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::ivec3> triangles;
+	bvh blas;
+
+private:
+	void gatherBounds();
+
+	std::vector<aabb> triangleBounds;
+};
@@ -0,0 +1,77 @@
+#include "outputQueue.h"
+#include "parallel.h"
+
+outputQueue::outputQueue(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {
+	thread = std::thread([this] { run(); });
+}
+
+void outputQueue::submit(std::function<bool()> job) {
+	auto start = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lock(mutex);
+	spaceFree.wait(lock, [this] { return jobs.size() < capacity; });
+	blocked += std::chrono::steady_clock::now() - start;
+	jobs.push_back(std::move(job));
+	jobReady.notify_one();
+}
+
+void outputQueue::submitImage(std::vector<std::vector<colorRGB>>&& pixels,
+	std::function<bool(const std::vector<std::vector<colorRGB>>& pixels)> write) {
+	// std::function needs a copyable callable, so the image rides along in a shared_ptr
+	auto image = std::make_shared<std::vector<std::vector<colorRGB>>>(std::move(pixels));
+	submit([image, write] { return write(*image); });
+}
+
+bool outputQueue::finish() {
+	if (thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closing = true;
+		}
+		jobReady.notify_one();
+		thread.join();
+	}
+	return !failed;
+}
+
+bool outputQueue::anyFailed() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return failed;
+}
+
+void outputQueue::run() {
+	// Encoders parallelize with parallelFor; here they run on this thread instead of waiting for the render
+	runParallelForSerially();
+	for (;;) {
+		std::function<bool()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobReady.wait(lock, [this] { return closing || !jobs.empty(); });
+			if (jobs.empty()) return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		spaceFree.notify_one();
+
+		auto start = std::chrono::steady_clock::now();
+		bool succeeded = job();
+		std::lock_guard<std::mutex> lock(mutex);
+		busy += std::chrono::steady_clock::now() - start;
+		failed = failed || !succeeded;
+	}
+}
+
+bool queuedSink::writeRows(int first, int count, const colorRGB* rows) {
+	if (*failed) return false;
+	auto band = std::make_shared<std::vector<colorRGB>>(rows, rows + static_cast<size_t>(width) * count);
+	std::shared_ptr<std::atomic<bool>> status = failed;
+	std::vector<scanlineSink*> sinks = targets;
+	queue.submit([band, status, sinks, first, count] {
+		// Once a target failed the bands still in the queue are dropped
+		if (*status) return false;
+		for (scanlineSink* sink : sinks)
+			if (!sink->writeRows(first, count, band->data()))
+				*status = true;
+		return !*status;
+	});
+	return true;
+}
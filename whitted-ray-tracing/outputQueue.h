@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "colorRGB.h"
+#include "scanlineSink.h"
+
+// Runs output work, encoding and writing finished images or bands of them, on one dedicated thread in the order
+// it was submitted, so it overlaps whatever the submitting threads render next. The queue is bounded: submit
+// blocks while capacity jobs are waiting, which caps the memory held by images that are not written yet
+class outputQueue
+{
+public:
+	explicit outputQueue(size_t capacity = 4);
+	~outputQueue() { finish(); }
+	outputQueue(const outputQueue&) = delete;
+	outputQueue& operator=(const outputQueue&) = delete;
+
+	// Queues job to run on the output thread. A job returns false when its output failed
+	void submit(std::function<bool()> job);
+
+	// Queues writing a whole image; the queue takes it over, so the caller can render the next one right away.
+	// write runs on the output thread and may produce any number of files from the image
+	void submitImage(std::vector<std::vector<colorRGB>>&& pixels,
+		std::function<bool(const std::vector<std::vector<colorRGB>>& pixels)> write);
+
+	// Waits for every queued job to finish and stops the thread. Returns false if any job failed
+	bool finish();
+
+	// Whether a job has failed so far, so that producers can stop early
+	bool anyFailed();
+
+	// Time submitters spent blocked on a full queue, and time the output thread spent running jobs
+	double blockedSeconds() const { return blocked.count(); }
+	double busySeconds() const { return busy.count(); }
+
+private:
+	void run();
+
+	size_t capacity;
+	std::mutex mutex;
+	std::condition_variable jobReady;
+	std::condition_variable spaceFree;
+	std::deque<std::function<bool()>> jobs;
+	bool closing = false;
+	bool failed = false;
+	std::chrono::duration<double> blocked{ 0.0 };
+	std::chrono::duration<double> busy{ 0.0 };
+	std::thread thread;
+};
+
+// A scanlineSink that copies each band and hands it to its targets on the output thread, so the renderer goes
+// on with the next band while the last one is encoded and written. Each target sees every band in order. The
+// render stops early once a target has failed
+class queuedSink : public scanlineSink
+{
+public:
+	queuedSink(outputQueue& queue, int width, std::vector<scanlineSink*> targets)
+		: queue(queue), width(width), targets(std::move(targets)) {}
+
+	bool writeRows(int first, int count, const colorRGB* rows) override;
+
+private:
+	outputQueue& queue;
+	int width;
+	std::vector<scanlineSink*> targets;
+	std::shared_ptr<std::atomic<bool>> failed = std::make_shared<std::atomic<bool>>(false);
+};
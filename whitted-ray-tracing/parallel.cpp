@@ -0,0 +1,118 @@
+#include "parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+	thread_local bool insideBody = false;
+	thread_local int currentWorker = 0;
+
+	class threadPool
+	{
+	public:
+		threadPool() {
+			unsigned hardwareThreads = std::thread::hardware_concurrency();
+			for (unsigned i = 1; i < hardwareThreads; ++i)
+				threads.emplace_back([this, i] { workerLoop(static_cast<int>(i)); });
+		}
+
+		~threadPool() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (std::thread& t : threads)
+				t.join();
+		}
+
+		int size() const { return static_cast<int>(threads.size()) + 1; }
+
+		void run(int count, const std::function<void(int, int)>& body) {
+			// Only one job can be in flight; concurrent callers from different threads queue up here
+			std::lock_guard<std::mutex> runLock(runMutex);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				job = &body;
+				jobCount = count;
+				next = 0;
+				active = static_cast<int>(threads.size());
+				++generation;
+			}
+			wake.notify_all();
+
+			work();
+
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this] { return active == 0; });
+			job = nullptr;
+		}
+
+	private:
+		void work() {
+			insideBody = true;
+			for (int i = next.fetch_add(1); i < jobCount; i = next.fetch_add(1))
+				(*job)(i, currentWorker);
+			insideBody = false;
+		}
+
+		void workerLoop(int worker) {
+			currentWorker = worker;
+			unsigned seen = 0;
+			for (;;) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [&] { return stopping || generation != seen; });
+					if (stopping) return;
+					seen = generation;
+				}
+
+				work();
+
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--active == 0) done.notify_one();
+			}
+		}
+
+		std::vector<std::thread> threads;
+		std::mutex runMutex;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		const std::function<void(int, int)>* job = nullptr;
+		int jobCount = 0;
+		std::atomic<int> next{ 0 };
+		int active = 0;
+		unsigned generation = 0;
+		bool stopping = false;
+	};
+
+	threadPool& pool() {
+		static threadPool instance;
+		return instance;
+	}
+}
+
+int workerCount() {
+	return pool().size();
+}
+
+int workerSlots() {
+	return pool().size() + 1;
+}
+
+void parallelFor(int count, const std::function<void(int index, int worker)>& body) {
+	if (insideBody || count <= 1 || pool().size() == 1) {
+		for (int i = 0; i < count; ++i)
+			body(i, currentWorker);
+		return;
+	}
+	pool().run(count, body);
+}
+
+void runParallelForSerially() {
+	insideBody = true;
+	currentWorker = workerCount();
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <functional>
+
+// Number of threads parallelFor spreads work over, including the calling thread
+int workerCount();
+
+// Number of distinct worker indices parallelFor can pass: one per pool thread plus one for the thread that called
+// runParallelForSerially(). Per-thread state that may be used from such a thread needs this many slots
+int workerSlots();
+
+// Calls body(index, worker) for every index in [0, count) on a persistent pool of threads.
+// worker is in [0, workerCount()) for the pool threads and identifies the executing thread, so it can be used to
+// index per-thread state. Calls made from inside a body run serially on the calling thread with its index, so
+// worker is only unique among the threads running this call: a thread outside the pool that calls parallelFor
+// directly also sees worker 0, the same as the main render thread.
+void parallelFor(int count, const std::function<void(int index, int worker)>& body);
+
+// Makes every later parallelFor call from the calling thread run serially on it, as if made from inside a body.
+// For threads that work alongside the pool, such as the output thread, which would otherwise wait for the pool
+// to finish the render before getting to run anything. Bodies see worker workerCount(), which no pool thread uses
+void runParallelForSerially();
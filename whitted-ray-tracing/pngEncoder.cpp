@@ -0,0 +1,130 @@
+#include "pngEncoder.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "deflate.h"
+#include "parallel.h"
+
+namespace {
+	void putBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+		const unsigned char bytes[4] = { static_cast<unsigned char>(value >> 24), static_cast<unsigned char>(value >> 16),
+			static_cast<unsigned char>(value >> 8), static_cast<unsigned char>(value) };
+		out.insert(out.end(), bytes, bytes + 4);
+	}
+
+	// Length, type, data and the CRC of type and data
+	void putChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size) {
+		putBigEndian(out, static_cast<uint32_t>(size));
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data, data + size);
+		putBigEndian(out, crc32(out.data() + start, size + 4));
+	}
+
+	int paeth(int a, int b, int c) {
+		int p = a + b - c;
+		int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+	}
+
+	// Residuals of one filter type over a row. above is all zeros for the first row
+	void applyFilter(int filter, const unsigned char* row, const unsigned char* above, int rowBytes, unsigned char* out) {
+		const int bpp = 3;
+		for (int i = 0; i < rowBytes; ++i) {
+			int left = i >= bpp ? row[i - bpp] : 0;
+			int upLeft = i >= bpp ? above[i - bpp] : 0;
+			int predicted;
+			switch (filter) {
+			case 0: predicted = 0; break;
+			case 1: predicted = left; break;
+			case 2: predicted = above[i]; break;
+			case 3: predicted = (left + above[i]) >> 1; break;
+			default: predicted = paeth(left, above[i], upLeft); break;
+			}
+			out[i] = static_cast<unsigned char>(row[i] - predicted);
+		}
+	}
+
+	// Writes the filter type byte and the filtered row to out, picking the filter whose residuals, read as signed
+	// values, have the smallest absolute sum
+	void filterRow(const unsigned char* row, const unsigned char* above, int rowBytes, unsigned char* out, unsigned char* candidate) {
+		long bestCost = -1;
+		for (int filter = 0; filter < 5; ++filter) {
+			applyFilter(filter, row, above, rowBytes, candidate);
+			long cost = 0;
+			for (int i = 0; i < rowBytes; ++i)
+				cost += std::abs(static_cast<signed char>(candidate[i]));
+			if (bestCost < 0 || cost < bestCost) {
+				bestCost = cost;
+				out[0] = static_cast<unsigned char>(filter);
+				std::memcpy(out + 1, candidate, rowBytes);
+			}
+		}
+	}
+}
+
+void encodePNG(const unsigned char* levels, int width, int height, bool srgb, std::vector<unsigned char>& out, size_t chunkBytes) {
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.assign(signature, signature + 8);
+
+	std::vector<unsigned char> header;
+	putBigEndian(header, width);
+	putBigEndian(header, height);
+	const unsigned char format[5] = { 8, 2, 0, 0, 0 };  // 8 bits per channel, RGB, deflate, adaptive filters, no interlace
+	header.insert(header.end(), format, format + 5);
+	putChunk(out, "IHDR", header.data(), header.size());
+	if (srgb) {
+		const unsigned char intent = 0;     // Perceptual
+		putChunk(out, "sRGB", &intent, 1);
+	}
+	else {
+		std::vector<unsigned char> gamma;
+		putBigEndian(gamma, 100000);
+		putChunk(out, "gAMA", gamma.data(), gamma.size());
+	}
+
+	// Filtering only looks at the unfiltered row above, so rows are independent
+	size_t rowBytes = static_cast<size_t>(width) * 3;
+	size_t filteredRow = rowBytes + 1;
+	std::vector<unsigned char> filtered(filteredRow * height);
+	std::vector<std::vector<unsigned char>> scratch(workerSlots(), std::vector<unsigned char>(rowBytes));
+	const std::vector<unsigned char> zeroRow(rowBytes, 0);
+	parallelFor(height, [&](int y, int worker) {
+		const unsigned char* row = levels + y * rowBytes;
+		filterRow(row, y > 0 ? row - rowBytes : zeroRow.data(), static_cast<int>(rowBytes), filtered.data() + y * filteredRow, scratch[worker].data());
+	});
+
+	// Each chunk becomes its own IDAT, so its CRC is computed by the thread that compressed it. The zlib header
+	// goes in front of the first and the Adler-32 of everything after the last
+	int rowsPerChunk = static_cast<int>(std::max<size_t>(chunkBytes / filteredRow, 1));
+	int chunkCount = height > 0 ? (height + rowsPerChunk - 1) / rowsPerChunk : 0;
+	std::vector<std::vector<unsigned char>> chunks(chunkCount);
+	std::vector<uint32_t> adlers(chunkCount);
+	parallelFor(chunkCount, [&](int c, int) {
+		size_t begin = static_cast<size_t>(c) * rowsPerChunk * filteredRow;
+		size_t end = std::min(begin + static_cast<size_t>(rowsPerChunk) * filteredRow, filtered.size());
+		std::vector<unsigned char>& chunk = chunks[c];
+		chunk.assign({ 'I', 'D', 'A', 'T' });
+		if (c == 0) chunk.insert(chunk.end(), { 0x78, 0x9C });
+		deflateChunk(filtered.data() + begin, end - begin, begin, c == chunkCount - 1, chunk);
+		adlers[c] = adler32(filtered.data() + begin, end - begin);
+	});
+
+	uint32_t adler = 1;
+	for (int c = 0; c < chunkCount; ++c) {
+		size_t begin = static_cast<size_t>(c) * rowsPerChunk * filteredRow;
+		size_t size = std::min(static_cast<size_t>(rowsPerChunk) * filteredRow, filtered.size() - begin);
+		adler = c == 0 ? adlers[0] : adler32Combine(adler, adlers[c], size);
+	}
+	if (chunkCount > 0)
+		putBigEndian(chunks.back(), adler);
+	parallelFor(chunkCount, [&](int c, int) {
+		putBigEndian(chunks[c], crc32(chunks[c].data(), chunks[c].size()));
+	});
+	for (const std::vector<unsigned char>& chunk : chunks) {
+		putBigEndian(out, static_cast<uint32_t>(chunk.size() - 8));
+		out.insert(out.end(), chunk.begin(), chunk.end());
+	}
+	putChunk(out, "IEND", nullptr, 0);
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Encodes interleaved 8-bit RGB as a PNG into out. Each row gets the filter with the smallest sum of absolute
+// residuals, then the filtered rows are deflated in chunks of about chunkBytes on the render threads. A chunk may
+// match against the 32 KB before it, so the ratio is close to compressing in one piece. srgb adds an sRGB chunk,
+// otherwise the data is tagged as linear with a gAMA of 1
+void encodePNG(const unsigned char* levels, int width, int height, bool srgb, std::vector<unsigned char>& out,
+	size_t chunkBytes = 256 * 1024);
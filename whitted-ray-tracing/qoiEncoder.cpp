@@ -0,0 +1,87 @@
+#include "qoiEncoder.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+	const unsigned char opIndex = 0x00;
+	const unsigned char opDiff = 0x40;
+	const unsigned char opLuma = 0x80;
+	const unsigned char opRun = 0xC0;
+	const unsigned char opRGB = 0xFE;
+
+	// Alpha is always 255 here, so it only enters the hash as a constant
+	int colorHash(unsigned char r, unsigned char g, unsigned char b) {
+		return (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+	}
+
+	void putBigEndian(unsigned char* out, uint32_t value) {
+		out[0] = static_cast<unsigned char>(value >> 24);
+		out[1] = static_cast<unsigned char>(value >> 16);
+		out[2] = static_cast<unsigned char>(value >> 8);
+		out[3] = static_cast<unsigned char>(value);
+	}
+}
+
+void encodeQOI(const unsigned char* levels, int width, int height, bool srgb, std::vector<unsigned char>& out) {
+	size_t pixelCount = static_cast<size_t>(width) * height;
+	// Worst case is every pixel as QOI_OP_RGB, plus header and end marker
+	out.resize(14 + pixelCount * 4 + 8);
+	unsigned char* p = out.data();
+	std::memcpy(p, "qoif", 4);
+	putBigEndian(p + 4, width);
+	putBigEndian(p + 8, height);
+	p[12] = 3;              // RGB
+	p[13] = srgb ? 0 : 1;   // sRGB with linear alpha, or all linear
+	p += 14;
+
+	// The decoder's cache starts out as transparent black, which no opaque pixel matches
+	unsigned char seen[64][3] = {};
+	bool cached[64] = {};
+	unsigned char previous[3] = { 0, 0, 0 };
+	int run = 0;
+	for (size_t i = 0; i < pixelCount; ++i) {
+		const unsigned char* c = levels + i * 3;
+		if (c[0] == previous[0] && c[1] == previous[1] && c[2] == previous[2]) {
+			if (++run == 62 || i + 1 == pixelCount) {
+				*p++ = static_cast<unsigned char>(opRun | (run - 1));
+				run = 0;
+			}
+			continue;
+		}
+		if (run > 0) {
+			*p++ = static_cast<unsigned char>(opRun | (run - 1));
+			run = 0;
+		}
+
+		int index = colorHash(c[0], c[1], c[2]);
+		if (cached[index] && std::memcmp(seen[index], c, 3) == 0)
+			*p++ = static_cast<unsigned char>(opIndex | index);
+		else {
+			std::memcpy(seen[index], c, 3);
+			cached[index] = true;
+			// Wrapping differences, as the decoder adds them modulo 256
+			int dr = static_cast<signed char>(c[0] - previous[0]);
+			int dg = static_cast<signed char>(c[1] - previous[1]);
+			int db = static_cast<signed char>(c[2] - previous[2]);
+			int drg = dr - dg, dbg = db - dg;
+			if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+				*p++ = static_cast<unsigned char>(opDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+			else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+				*p++ = static_cast<unsigned char>(opLuma | (dg + 32));
+				*p++ = static_cast<unsigned char>((drg + 8) << 4 | (dbg + 8));
+			}
+			else {
+				*p++ = opRGB;
+				*p++ = c[0];
+				*p++ = c[1];
+				*p++ = c[2];
+			}
+		}
+		std::memcpy(previous, c, 3);
+	}
+
+	const unsigned char end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	std::memcpy(p, end, 8);
+	p += 8;
+	out.resize(p - out.data());
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <vector>
+
+// Encodes interleaved 8-bit RGB as a QOI image into out: runs, a 64-entry cache of recent colors and small deltas
+// from the previous pixel, all in one pass. srgb only sets the colorspace byte of the header
+void encodeQOI(const unsigned char* levels, int width, int height, bool srgb, std::vector<unsigned char>& out);
@@ -1,24 +1,37 @@
 #pragma once
+#include <cfloat>
 #include "glm/glm.hpp"
-#include "colorRGB.h"
 
-class ray
+// Offset applied to the start of rays leaving a surface so they do not hit it again
+constexpr float rayEpsilon = 1e-4f;
+
+// The part of a ray that traversal and intersection read: origin, direction and the valid interval
+// (tMin, tMax) in the first 32 bytes, then the reciprocal direction and direction signs for slab tests,
+// precomputed once per ray. Whatever shading carries along with a ray lives elsewhere (see rayPayload)
+class alignas(32) ray
 {
 public:
-    ray() { color = colorRGB(); }
+    ray() {}
 
-    ray(const glm::vec3& origin, const glm::vec3& direction) : orig(origin), dir(direction) {}
+    ray(const glm::vec3& origin, const glm::vec3& direction, float tMin = rayEpsilon, float tMax = FLT_MAX)
+        : orig(origin), minT(tMin), dir(direction), maxT(tMax), invDir(1.0f / direction),
+          signs((direction.x < 0.0f ? 1u : 0u) | (direction.y < 0.0f ? 2u : 0u) | (direction.z < 0.0f ? 4u : 0u)) {}
 
-    glm::vec3 origin() const { return orig; }
-    glm::vec3 direction() const { return dir; }
-    colorRGB getColor() const { return color; }
+    const glm::vec3& origin() const { return orig; }
+    const glm::vec3& direction() const { return dir; }
+    float tMin() const { return minT; }
+    float tMax() const { return maxT; }
+    const glm::vec3& invDirection() const { return invDir; }
+    // True if the direction points towards -axis
+    bool negative(int axis) const { return (signs >> axis) & 1u; }
 
+    glm::vec3 at(float t) const { return orig + t * dir; }
 
 private:
     glm::vec3 orig;
+    float minT = rayEpsilon;
     glm::vec3 dir;
-    ray* prev;
-    ray* next;
-    colorRGB color;
+    float maxT = FLT_MAX;
+    glm::vec3 invDir;
+    unsigned signs = 0;
 };
-
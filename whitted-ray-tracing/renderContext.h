@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include "arena.h"
+#include "colorRGB.h"
+#include "hitInfo.h"
+#include "ray.h"
+#include "renderSettings.h"
+#include "renderStats.h"
+
+// Upper bound on renderSettings::maxDepth; sizes the per-thread ray stack
+constexpr int maxTraceDepth = 16;
+
+// Rays intersected and shaded together. Hits of a batch are shaded grouped by material
+constexpr int shadeBatchSize = 64;
+
+// Each batch takes at most shadeBatchSize rays off the top of the stack and pushes at most two children
+// per ray, so at most shadeBatchSize entries per level stay pending below the newest children
+constexpr int rayStackSize = shadeBatchSize * (maxTraceDepth + 2);
+
+// Shading state carried along with a ray of the Whitted ray tree. Kept apart from the ray itself so
+// traversal only touches the compact ray
+struct rayPayload {
+	colorRGB weight;    // Product of the reflection/transmission coefficients from the camera down to this ray
+	int depth;
+	int sample;         // Camera ray of the batch this ray descends from, i.e. where its color goes
+};
+
+// State owned by one render thread and passed down through shading, so nothing in the hot path is shared
+struct renderContext {
+	const renderSettings* settings = nullptr;
+
+	// Per light, the object that blocked the last shadow ray towards it, or -1. Neighbouring shadow rays
+	// are usually blocked by the same object, so it is tried before a full occlusion query
+	std::vector<int> lastOccluder;
+	renderStats stats;
+
+	// Explicit stack for walking the ray tree depth first, a batch at a time. Rays and payloads sit in
+	// parallel arrays, entry i of one belonging to entry i of the other
+	ray rayStack[rayStackSize];
+	rayPayload payloadStack[rayStackSize];
+
+	// The batch being shaded: hits and payloads of the rays taken off the stack, and the order of the
+	// hit ones sorted by material
+	HitInfo batchHits[shadeBatchSize];
+	surfaceInteraction batchSurfaces[shadeBatchSize];
+	glm::vec3 batchDirections[shadeBatchSize];
+	rayPayload batchPayloads[shadeBatchSize];
+	int batchOrder[shadeBatchSize];
+
+	// Transient memory for the pixel or tile being rendered, reset after each one
+	arena scratch;
+};
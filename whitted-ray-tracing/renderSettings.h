@@ -0,0 +1,36 @@
+#pragma once
+
+enum class antialiasMode {
+	none,       // One ray per pixel
+	uniform,    // samplesPerAxis x samplesPerAxis rays in every pixel
+	adaptive,   // Rays at shared pixel corners, subdividing only where they disagree
+};
+
+// Options controlling how a frame is rendered
+struct renderSettings {
+	// Reflection/refraction bounces followed from each camera ray, at most maxTraceDepth
+	int maxDepth = 5;
+	// Secondary rays whose weight (largest channel of the product of reflection/transmission coefficients
+	// down to them) falls below this are not traced. 0 follows every branch down to maxDepth
+	double minContribution = 0.01;
+	antialiasMode antialiasing = antialiasMode::none;
+	int samplesPerAxis = 4;
+	// Adaptive sampling splits a square while its corner colors differ by more than adaptiveThreshold in any
+	// channel, at most adaptiveDepth times per pixel
+	double adaptiveThreshold = 0.05;
+	int adaptiveDepth = 3;
+	// Shade each material with the kernel compiled for its feature set rather than the one evaluating every term
+	bool specializedShading = true;
+	// Pick the lights for each shading point from the scene's light BVH, skipping any that could deliver less than
+	// minLightContribution (largest channel) there, or that lie below the surface, without casting shadow rays
+	bool lightTree = true;
+	float minLightContribution = 0.001f;
+	// Let shadow rays through transmissive materials, attenuated by their transmissivity at every surface
+	// crossing, instead of treating them as opaque. Light dimmed below minTransmittance counts as blocked
+	bool transparentShadows = true;
+	float minTransmittance = 0.001f;
+	// Try the object that blocked the previous shadow ray towards a light before the full occlusion query
+	bool occluderCache = true;
+	// Print the remaining scanline count while rendering
+	bool showProgress = false;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <ostream>
+
+// Counters gathered per render thread and summed at the end of a frame
+struct renderStats {
+	long long primaryRays = 0;
+	long long reflectionRays = 0;
+	long long refractionRays = 0;
+	long long culledRays = 0;           // Secondary rays dropped by renderSettings::minContribution
+	long long shadedHits = 0;
+	long long shadowRays = 0;
+	long long culledLights = 0;         // Lights skipped by the light BVH without a shadow ray
+	long long occluderCacheTests = 0;   // Shadow rays that had a cached occluder to try first
+	long long occluderCacheHits = 0;    // ... and were blocked by it, skipping the full occlusion query
+
+	renderStats& operator+=(const renderStats& s) {
+		primaryRays += s.primaryRays;
+		reflectionRays += s.reflectionRays;
+		refractionRays += s.refractionRays;
+		culledRays += s.culledRays;
+		shadedHits += s.shadedHits;
+		shadowRays += s.shadowRays;
+		culledLights += s.culledLights;
+		occluderCacheTests += s.occluderCacheTests;
+		occluderCacheHits += s.occluderCacheHits;
+		return *this;
+	}
+
+	void print(std::ostream& out) const {
+		out << "Primary rays:        " << primaryRays << "\n";
+		out << "Reflection rays:     " << reflectionRays << "\n";
+		out << "Refraction rays:     " << refractionRays << "\n";
+		out << "Culled rays:         " << culledRays << "\n";
+		out << "Shadow rays:         " << shadowRays;
+		if (shadedHits > 0)
+			out << " (" << static_cast<double>(shadowRays) / shadedHits << " per hit)";
+		out << "\n";
+		out << "Culled lights:       " << culledLights << "\n";
+		out << "Occluder cache hits: " << occluderCacheHits << " / " << occluderCacheTests;
+		if (occluderCacheTests > 0)
+			out << " (" << 100.0 * occluderCacheHits / occluderCacheTests << "%)";
+		out << "\n";
+	}
+};
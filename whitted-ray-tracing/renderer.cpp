@@ -0,0 +1,550 @@
+#include "renderer.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include "allocationCounter.h"
+#include "parallel.h"
+
+namespace {
+	// Shadow ray towards one light, returning the fraction of its light that arrives. With the occluder cache on,
+	// the opaque object that blocked this thread's previous ray towards the same light is tried first, which
+	// usually settles the query without any traversal
+	float lightVisibility(const scene& world, renderContext& context, int lightIndex, const ray& shadowRay) {
+		context.stats.shadowRays++;
+		const renderSettings& settings = *context.settings;
+		bool transparent = settings.transparentShadows && (world.materials.usedFeatures & refractionFeature);
+		if (!settings.occluderCache) {
+			int occluder;
+			return transparent ? world.transmittance(shadowRay, settings.minTransmittance, occluder) : world.occluded(shadowRay) ? 0.0f : 1.0f;
+		}
+
+		int& cached = context.lastOccluder[lightIndex];
+		if (cached >= 0) {
+			context.stats.occluderCacheTests++;
+			if (world.occludedBy(cached, shadowRay)) {
+				context.stats.occluderCacheHits++;
+				return 0.0f;
+			}
+		}
+		if (transparent)
+			return world.transmittance(shadowRay, settings.minTransmittance, cached);
+		return world.occluded(shadowRay, cached) ? 0.0f : 1.0f;
+	}
+
+	// Queues a secondary ray unless its contribution to the pixel is too small to matter (Hall and Greenberg's
+	// adaptive tree depth control). Returns false if the ray was culled
+	bool spawn(renderContext& context, int& stackSize, const glm::vec3& origin, const glm::vec3& direction,
+		const colorRGB& weight, int depth, int sample) {
+		double contribution = glm::max(weight.r, glm::max(weight.g, weight.b));
+		if (contribution <= 0.0) return false;
+		if (contribution < context.settings->minContribution) {
+			context.stats.culledRays++;
+			return false;
+		}
+		assert(stackSize < rayStackSize);
+		context.rayStack[stackSize] = ray(origin, direction);
+		context.payloadStack[stackSize] = { weight, depth, sample };
+		++stackSize;
+		return true;
+	}
+
+	// Local illumination with the material's parameters already loaded. Light is gathered first and
+	// filtered by the material once at the end. Features is a materialFeatures mask; terms it leaves out
+	// are compiled away
+	template <unsigned Features>
+	colorRGB shadeLocal(const scene& world, renderContext& context, const surfaceInteraction& surface,
+		const glm::vec3& viewDirection, const material& m) {
+		// Light the side of the surface the ray arrived from
+		glm::vec3 normal = glm::dot(surface.normal, viewDirection) > 0.0f ? -surface.normal : surface.normal;
+
+		colorRGB diffuseLight(0.1, 0.1, 0.1);   // Ambient
+		colorRGB specularLight;
+		auto gather = [&](int lightIndex) {
+			const light& l = world.lights[lightIndex];
+			glm::vec3 toLight = l.position - surface.point;
+			float distanceSquared = glm::dot(toLight, toLight);
+			float distance = glm::sqrt(distanceSquared);
+			glm::vec3 lightDirection = toLight / distance;
+			float cosTheta = glm::dot(normal, lightDirection);
+			if (cosTheta <= 0.0f) return;
+
+			// Any-hit query rather than a closest hit; transmissive objects along the way only dim the light
+			ray shadowRay(surface.point + rayEpsilon * normal, lightDirection, rayEpsilon, distance);
+			float visibility = lightVisibility(world, context, lightIndex, shadowRay);
+			if (visibility == 0.0f) return;
+
+			colorRGB intensity = (visibility * l.attenuation(distanceSquared)) * l.intensity;
+			diffuseLight = diffuseLight + cosTheta * intensity;
+			if (Features & specularFeature) {
+				float highlight = glm::max(glm::dot(glm::reflect(-lightDirection, normal), -viewDirection), 0.0f);
+				specularLight = specularLight + glm::pow(highlight, m.shininess) * intensity;
+			}
+		};
+
+		context.stats.shadedHits++;
+		if (context.settings->lightTree)
+			context.stats.culledLights += world.lightBvh.query(surface.point, normal, context.settings->minLightContribution, gather);
+		else {
+			for (size_t lightIndex = 0; lightIndex < world.lights.size(); ++lightIndex)
+				gather(static_cast<int>(lightIndex));
+		}
+		if (Features & specularFeature)
+			return m.diffuse * diffuseLight + m.specular * specularLight;
+		return m.diffuse * diffuseLight;
+	}
+
+	// Everything a shading kernel reads and writes besides the hits themselves
+	struct batchState {
+		const scene& world;
+		renderContext& context;
+		colorRGB* results;
+		int& stackSize;
+		int maxDepth;
+	};
+
+	// Shades the hits order[0..count), which all use material m, and spawns their secondary rays
+	template <unsigned Features>
+	void shadeRun(const batchState& batch, const int* order, int count, const material& m) {
+		renderContext& context = batch.context;
+		for (int k = 0; k < count; ++k) {
+			const surfaceInteraction& surface = context.batchSurfaces[order[k]];
+			const glm::vec3& direction = context.batchDirections[order[k]];
+			const rayPayload& task = context.batchPayloads[order[k]];
+			batch.results[task.sample] = batch.results[task.sample] + task.weight * shadeLocal<Features>(batch.world, context, surface, direction, m);
+			if (!(Features & (reflectionFeature | refractionFeature)) || task.depth >= batch.maxDepth) continue;
+
+			bool entering = glm::dot(direction, surface.normal) < 0.0f;
+			glm::vec3 normal = entering ? surface.normal : -surface.normal;
+			float reflectWeight = m.reflectivity;
+			if (Features & refractionFeature) {
+				glm::vec3 refracted = glm::refract(direction, normal, entering ? 1.0f / m.ior : m.ior);
+				// Total internal reflection hands the transmitted share to the reflected ray
+				float totalInternal = refracted == glm::vec3(0.0f) ? 1.0f : 0.0f;
+				reflectWeight += totalInternal * m.transmissivity;
+				float refractWeight = (1.0f - totalInternal) * m.transmissivity;
+				if (spawn(context, batch.stackSize, surface.point - rayEpsilon * normal, refracted, task.weight * refractWeight, task.depth + 1, task.sample))
+					context.stats.refractionRays++;
+			}
+			if (spawn(context, batch.stackSize, surface.point + rayEpsilon * normal, glm::reflect(direction, normal), task.weight * reflectWeight, task.depth + 1, task.sample))
+				context.stats.reflectionRays++;
+		}
+	}
+
+	// One instantiation per feature combination, indexed by the mask materialTable::add() computed for each material
+	typedef void (*shadeKernel)(const batchState& batch, const int* order, int count, const material& m);
+	const shadeKernel shadeKernels[allFeatures + 1] = {
+		shadeRun<0>, shadeRun<1>, shadeRun<2>, shadeRun<3>, shadeRun<4>, shadeRun<5>, shadeRun<6>, shadeRun<7>,
+	};
+}
+
+colorRGB shade(const scene& world, renderContext& context, const surfaceInteraction& surface, const glm::vec3& viewDirection) {
+	return shadeLocal<allFeatures>(world, context, surface, viewDirection, world.materials.get(surface.material));
+}
+
+void traceBatch(const scene& world, renderContext& context, const ray* cameraRays, int count, colorRGB* results) {
+	assert(count <= shadeBatchSize);
+	for (int k = 0; k < count; ++k) {
+		context.rayStack[k] = cameraRays[k];
+		context.payloadStack[k] = { colorRGB(1.0, 1.0, 1.0), 0, k };
+		results[k] = colorRGB();
+	}
+	int stackSize = count;
+	batchState batch = { world, context, results, stackSize, glm::min(context.settings->maxDepth, maxTraceDepth) };
+
+	const surfaceInteraction* surfaces = context.batchSurfaces;
+	int* order = context.batchOrder;
+	while (stackSize > 0) {
+		// Take the newest rays off the stack and find their closest hits
+		int batchCount = glm::min(stackSize, shadeBatchSize);
+		int base = stackSize - batchCount;
+		int hitCount = 0;
+		for (int k = 0; k < batchCount; ++k) {
+			const ray& r = context.rayStack[base + k];
+			if (!world.intersect(r, context.batchHits[k])) continue;    // Black background
+			world.computeSurfaceInteraction(r, context.batchHits[k], context.batchSurfaces[k]);
+			context.batchDirections[k] = r.direction();
+			context.batchPayloads[k] = context.payloadStack[base + k];
+			order[hitCount++] = k;
+		}
+		stackSize = base;
+
+		// Shade grouped by material, so each material's parameters are fetched from the table and its kernel
+		// picked once per run of hits
+		std::sort(order, order + hitCount, [surfaces](int a, int b) {
+			return surfaces[a].material != surfaces[b].material ? surfaces[a].material < surfaces[b].material : a < b;
+		});
+		for (int run = 0; run < hitCount;) {
+			int id = surfaces[order[run]].material;
+			int runEnd = run + 1;
+			while (runEnd < hitCount && surfaces[order[runEnd]].material == id)
+				++runEnd;
+
+			unsigned features = context.settings->specializedShading ? world.materials.features[id] : allFeatures;
+			shadeKernels[features](batch, order + run, runEnd - run, world.materials.get(id));
+			run = runEnd;
+		}
+	}
+}
+
+colorRGB trace(const scene& world, renderContext& context, const ray& cameraRay) {
+	colorRGB result;
+	traceBatch(world, context, &cameraRay, 1, &result);
+	return result;
+}
+
+namespace {
+	// Primary samples at continuous pixel coordinates; (j, i) is the top-left corner of pixel j of scanline i
+	struct pixelSampler {
+		const scene& world;
+		renderContext& context;
+		const camera& cam;
+		float width;
+		float height;
+
+		ray primary(float x, float y) const {
+			float ndcX = 2.0f * x / width - 1.0f;
+			float ndcY = 1.0f - 2.0f * y / height;
+			context.stats.primaryRays++;
+			return cam.getRay(ndcX, ndcY);
+		}
+
+		// Traces the samples at (xs[k], ys[k]) into results[k], in batches of shadeBatchSize
+		void operator()(const float* xs, const float* ys, int count, colorRGB* results) const {
+			ray rays[shadeBatchSize];
+			for (int first = 0; first < count; first += shadeBatchSize) {
+				int batchCount = glm::min(count - first, shadeBatchSize);
+				for (int k = 0; k < batchCount; ++k)
+					rays[k] = primary(xs[first + k], ys[first + k]);
+				traceBatch(world, context, rays, batchCount, results + first);
+			}
+		}
+
+		// A whole row of samples at integer coordinates
+		void row(int y, int count, colorRGB* results) const {
+			ray rays[shadeBatchSize];
+			for (int first = 0; first < count; first += shadeBatchSize) {
+				int batchCount = glm::min(count - first, shadeBatchSize);
+				for (int k = 0; k < batchCount; ++k)
+					rays[k] = primary(static_cast<float>(first + k), static_cast<float>(y));
+				traceBatch(world, context, rays, batchCount, results + first);
+			}
+		}
+	};
+
+	bool cornersDiffer(const colorRGB corners[4], double threshold) {
+		double low[3] = { corners[0].r, corners[0].g, corners[0].b };
+		double high[3] = { low[0], low[1], low[2] };
+		for (int k = 1; k < 4; ++k) {
+			const double c[3] = { corners[k].r, corners[k].g, corners[k].b };
+			for (int channel = 0; channel < 3; ++channel) {
+				low[channel] = glm::min(low[channel], c[channel]);
+				high[channel] = glm::max(high[channel], c[channel]);
+			}
+		}
+		return high[0] - low[0] > threshold || high[1] - low[1] > threshold || high[2] - low[2] > threshold;
+	}
+
+	// Whitted's adaptive supersampling over the square at (x, y). Corners are top-left, top-right, bottom-left,
+	// bottom-right. While they disagree the square is split in four, tracing only the five new sample points
+	colorRGB refine(const pixelSampler& sample, float x, float y, float size, const colorRGB corners[4], int depth, double threshold) {
+		if (depth == 0 || !cornersDiffer(corners, threshold))
+			return 0.25 * (corners[0] + corners[1] + corners[2] + corners[3]);
+
+		// Top, left, center, right and bottom, traced as one batch
+		float half = 0.5f * size;
+		const float xs[5] = { x + half, x, x + half, x + size, x + half };
+		const float ys[5] = { y, y + half, y + half, y + half, y + size };
+		colorRGB points[5];
+		sample(xs, ys, 5, points);
+		const colorRGB& top = points[0];
+		const colorRGB& left = points[1];
+		const colorRGB& center = points[2];
+		const colorRGB& right = points[3];
+		const colorRGB& bottom = points[4];
+
+		const colorRGB topLeft[4] = { corners[0], top, left, center };
+		const colorRGB topRight[4] = { top, corners[1], center, right };
+		const colorRGB bottomLeft[4] = { left, center, corners[2], bottom };
+		const colorRGB bottomRight[4] = { center, right, bottom, corners[3] };
+		return 0.25 * (refine(sample, x, y, half, topLeft, depth - 1, threshold)
+			+ refine(sample, x + half, y, half, topRight, depth - 1, threshold)
+			+ refine(sample, x, y + half, half, bottomLeft, depth - 1, threshold)
+			+ refine(sample, x + half, y + half, half, bottomRight, depth - 1, threshold));
+	}
+
+	// Scanlines [first, last) with adaptive supersampling, scanline i going to rowPointer(i). Corner rows live in
+	// the context's scratch arena and the bottom row of each scanline becomes the top row of the next
+	template <typename RowPointer>
+	void renderAdaptiveBand(const pixelSampler& sample, RowPointer&& rowPointer, int first, int last, const renderSettings& settings) {
+		heapAllocationGuard noHeap;
+		int width = static_cast<int>(sample.width);
+		arena& scratch = sample.context.scratch;
+		colorRGB* top = scratch.allocate<colorRGB>(width + 1);
+		colorRGB* bottom = scratch.allocate<colorRGB>(width + 1);
+
+		sample.row(first, width + 1, top);
+		for (int i = first; i < last; ++i) {
+			sample.row(i + 1, width + 1, bottom);
+			colorRGB* pixels = rowPointer(i);
+			for (int j = 0; j < width; ++j) {
+				const colorRGB corners[4] = { top[j], top[j + 1], bottom[j], bottom[j + 1] };
+				pixels[j] = refine(sample, static_cast<float>(j), static_cast<float>(i), 1.0f, corners,
+					settings.adaptiveDepth, settings.adaptiveThreshold);
+			}
+			std::swap(top, bottom);
+		}
+		scratch.reset();
+	}
+
+	// One scanline with n x n samples per pixel, or a single sample at the pixel corner for n = 1. Samples are
+	// traced a batch at a time and summed into their pixels
+	void renderScanline(const pixelSampler& sample, colorRGB* pixels, int i, int n) {
+		heapAllocationGuard noHeap;
+		int width = static_cast<int>(sample.width);
+		if (n == 1) {
+			sample.row(i, width, pixels);
+			return;
+		}
+
+		int samplesPerPixel = n * n;
+		int total = width * samplesPerPixel;
+		float xs[shadeBatchSize], ys[shadeBatchSize];
+		colorRGB results[shadeBatchSize];
+		for (int j = 0; j < width; ++j)
+			pixels[j] = colorRGB();
+		for (int first = 0; first < total; first += shadeBatchSize) {
+			int count = glm::min(total - first, shadeBatchSize);
+			for (int k = 0; k < count; ++k) {
+				// Regular n x n grid of samples inside the pixel
+				int s = first + k;
+				int j = s / samplesPerPixel;
+				int sub = s % samplesPerPixel;
+				xs[k] = j + (sub % n + 0.5f) / n;
+				ys[k] = i + (sub / n + 0.5f) / n;
+			}
+			sample(xs, ys, count, results);
+			for (int k = 0; k < count; ++k) {
+				int j = (first + k) / samplesPerPixel;
+				pixels[j] = pixels[j] + results[k];
+			}
+		}
+		for (int j = 0; j < width; ++j)
+			pixels[j] = pixels[j] * (1.0 / samplesPerPixel);
+	}
+
+	// The pixels of scanline i in every step-th column, or only in the odd multiples of step when oddOnly, sampled as
+	// renderScanline would. The pixels in between are left alone
+	void renderPixelSubset(const pixelSampler& sample, colorRGB* pixels, int i, int width, int step, bool oddOnly, int n) {
+		heapAllocationGuard noHeap;
+		int firstColumn = oddOnly ? step : 0;
+		int stride = oddOnly ? 2 * step : step;
+		int columns = firstColumn < width ? (width - 1 - firstColumn) / stride + 1 : 0;
+		int samplesPerPixel = n * n;
+		int total = columns * samplesPerPixel;
+		float xs[shadeBatchSize], ys[shadeBatchSize];
+		colorRGB results[shadeBatchSize];
+		for (int c = 0; c < columns; ++c)
+			pixels[firstColumn + c * stride] = colorRGB();
+		for (int first = 0; first < total; first += shadeBatchSize) {
+			int count = glm::min(total - first, shadeBatchSize);
+			for (int k = 0; k < count; ++k) {
+				int s = first + k;
+				int j = firstColumn + s / samplesPerPixel * stride;
+				int sub = s % samplesPerPixel;
+				xs[k] = n == 1 ? static_cast<float>(j) : j + (sub % n + 0.5f) / n;
+				ys[k] = n == 1 ? static_cast<float>(i) : i + (sub / n + 0.5f) / n;
+			}
+			sample(xs, ys, count, results);
+			for (int k = 0; k < count; ++k) {
+				int j = firstColumn + (first + k) / samplesPerPixel * stride;
+				pixels[j] = pixels[j] + results[k];
+			}
+		}
+		if (n > 1)
+			for (int c = 0; c < columns; ++c)
+				pixels[firstColumn + c * stride] = pixels[firstColumn + c * stride] * (1.0 / samplesPerPixel);
+	}
+
+	// The render threads of one frame: a context for each, and progress over the whole image
+	class frameRenderer
+	{
+	public:
+		frameRenderer(const scene& world, const camera& cam, const renderSettings& settings)
+			: world(world), cam(cam), settings(settings), contexts(workerCount()) {
+			for (renderContext& context : contexts) {
+				context.settings = &settings;
+				context.lastOccluder.assign(world.lights.size(), -1);
+				// Enough for the two corner rows of adaptive sampling
+				context.scratch.reserve(2 * (cam.width + 1) * sizeof(colorRGB) + 2 * alignof(colorRGB));
+			}
+		}
+
+		// Scanlines one render thread takes at a time
+		int rowsPerTask() const { return settings.antialiasing == antialiasMode::adaptive ? bandHeight : 1; }
+
+		// Renders scanlines [first, last) on all render threads, scanline i into rowPointer(i, worker). Each task's
+		// scanlines [taskFirst, taskLast) are passed to rowsDone(taskFirst, taskLast, worker) once finished
+		template <typename RowPointer, typename RowsDone>
+		void run(int first, int last, RowPointer&& rowPointer, RowsDone&& rowsDone) {
+			run(first, last, rowPointer, rowsDone, [](int, int) { return false; });
+		}
+
+		// As above, but tasks for which skipTask(taskFirst, taskLast) returns true are left out
+		template <typename RowPointer, typename RowsDone, typename SkipTask>
+		void run(int first, int last, RowPointer&& rowPointer, RowsDone&& rowsDone, SkipTask&& skipTask) {
+			if (settings.antialiasing == antialiasMode::adaptive) {
+				// Bands of scanlines per task: the bottom corner row of one scanline is the top row of the next, so
+				// only the first row of each band is traced twice
+				int bandCount = (last - first + bandHeight - 1) / bandHeight;
+				parallelFor(bandCount, [&](int band, int worker) {
+					pixelSampler sample = this->sampler(worker);
+					int bandFirst = first + band * bandHeight;
+					int bandLast = glm::min(bandFirst + bandHeight, last);
+					if (skipTask(bandFirst, bandLast)) {
+						scanlinesDone(bandLast - bandFirst, worker);
+						return;
+					}
+					renderAdaptiveBand(sample, [&](int i) { return rowPointer(i, worker); }, bandFirst, bandLast, settings);
+					rowsDone(bandFirst, bandLast, worker);
+					scanlinesDone(bandLast - bandFirst, worker);
+				});
+			}
+			else {
+				// Iterate over pixels, handing out one scanline at a time to the render threads
+				int n = settings.antialiasing == antialiasMode::uniform ? glm::max(settings.samplesPerAxis, 1) : 1;
+				parallelFor(last - first, [&](int index, int worker) {
+					int i = first + index;
+					if (skipTask(i, i + 1)) {
+						scanlinesDone(1, worker);
+						return;
+					}
+					renderScanline(this->sampler(worker), rowPointer(i, worker), i, n);
+					rowsDone(i, i + 1, worker);
+					scanlinesDone(1, worker);
+				});
+			}
+		}
+
+		// Calls body(index, sampler) for every index in [0, count) on all render threads, without progress output
+		template <typename Body>
+		void forEach(int count, Body&& body) {
+			parallelFor(count, [&](int index, int worker) { body(index, this->sampler(worker)); });
+		}
+
+		renderStats stats() const {
+			renderStats total;
+			for (const renderContext& context : contexts)
+				total += context.stats;
+			return total;
+		}
+
+	private:
+		static constexpr int bandHeight = 16;
+
+		pixelSampler sampler(int worker) {
+			return { world, contexts[worker], cam, static_cast<float>(cam.width), static_cast<float>(cam.height) };
+		}
+
+		void scanlinesDone(int count, int worker) {
+			int done = finished += count;
+			if (settings.showProgress && worker == 0)
+				std::clog << "\rScanlines remaining: " << (cam.height - done) << ' ' << std::flush;
+		}
+
+		const scene& world;
+		const camera& cam;
+		const renderSettings& settings;
+		std::vector<renderContext> contexts;
+		std::atomic<int> finished{ 0 };
+	};
+}
+
+renderStats render(const scene& world, camera& cam, const renderSettings& settings) {
+	assert(static_cast<int>(cam.pixels.size()) == cam.height);
+	frameRenderer frame(world, cam, settings);
+	frame.run(0, cam.height, [&](int i, int) { return cam.pixels[i].data(); }, [](int, int, int) {});
+	return frame.stats();
+}
+
+renderStats renderResuming(const scene& world, camera& cam, const renderSettings& settings,
+	const std::function<bool(int first, int last)>& finished, const std::function<void(int first, int last)>& rowsDone) {
+	assert(static_cast<int>(cam.pixels.size()) == cam.height);
+	frameRenderer frame(world, cam, settings);
+	frame.run(0, cam.height, [&](int i, int) { return cam.pixels[i].data(); }, [&](int first, int last, int) { rowsDone(first, last); },
+		[&](int first, int last) { return finished(first, last); });
+	return frame.stats();
+}
+
+renderStats renderProgressive(const scene& world, camera& cam, const renderSettings& settings, const std::function<void(int step)>& passDone) {
+	assert(static_cast<int>(cam.pixels.size()) == cam.height);
+	const int firstStep = 8;
+	frameRenderer frame(world, cam, settings);
+	bool adaptive = settings.antialiasing == antialiasMode::adaptive;
+	int n = settings.antialiasing == antialiasMode::uniform ? glm::max(settings.samplesPerAxis, 1) : 1;
+
+	// Adaptive sampling refines from the samples at pixel corners, one row and column more than there are pixels.
+	// The passes fill that grid, and the previews show it
+	int width = cam.width + (adaptive ? 1 : 0);
+	int height = cam.height + (adaptive ? 1 : 0);
+	std::vector<std::vector<colorRGB>> corners(adaptive ? height : 0, std::vector<colorRGB>(width));
+	std::vector<std::vector<colorRGB>>& samples = adaptive ? corners : cam.pixels;
+
+	for (int step = firstStep; step >= 1; step /= 2) {
+		// Every step-th column of every step-th scanline. Where a scanline was already on the coarser grid of the
+		// previous pass, only the odd multiples of step are new
+		frame.forEach((height - 1) / step + 1, [&](int index, const pixelSampler& sample) {
+			int i = index * step;
+			bool oddOnly = step < firstStep && i % (2 * step) == 0;
+			renderPixelSubset(sample, samples[i].data(), i, width, step, oddOnly, n);
+		});
+
+		if (adaptive && step == 1) {
+			frame.forEach(cam.height, [&](int i, const pixelSampler& sample) {
+				for (int j = 0; j < cam.width; ++j) {
+					const colorRGB square[4] = { corners[i][j], corners[i][j + 1], corners[i + 1][j], corners[i + 1][j + 1] };
+					cam.pixels[i][j] = refine(sample, static_cast<float>(j), static_cast<float>(i), 1.0f, square,
+						settings.adaptiveDepth, settings.adaptiveThreshold);
+				}
+			});
+		}
+		else if (step > 1) {
+			// Preview: each pixel not traced yet takes the color of the traced one above and to the left of it
+			parallelFor(cam.height, [&](int i, int) {
+				const std::vector<colorRGB>& source = samples[i - i % step];
+				for (int j = 0; j < cam.width; ++j)
+					if (adaptive || i % step != 0 || j % step != 0)
+						cam.pixels[i][j] = source[j - j % step];
+			});
+		}
+		passDone(step);
+	}
+	return frame.stats();
+}
+
+renderStats renderStreaming(const scene& world, const camera& cam, const renderSettings& settings, int windowRows, scanlineSink& sink) {
+	frameRenderer frame(world, cam, settings);
+	windowRows = glm::clamp(windowRows, 1, glm::max(cam.height, 1));
+	std::vector<colorRGB> window(static_cast<size_t>(windowRows) * cam.width);
+	for (int first = 0; first < cam.height; first += windowRows) {
+		int last = glm::min(first + windowRows, cam.height);
+		frame.run(first, last, [&](int i, int) { return window.data() + static_cast<size_t>(i - first) * cam.width; }, [](int, int, int) {});
+		if (!sink.writeRows(first, last - first, window.data())) break;
+	}
+	return frame.stats();
+}
+
+renderStats renderScanlines(const scene& world, const camera& cam, const renderSettings& settings,
+	const std::function<void(int y, const colorRGB* pixels)>& rowDone) {
+	frameRenderer frame(world, cam, settings);
+	// Room for the scanlines of one task per render thread
+	int rows = frame.rowsPerTask();
+	std::vector<std::vector<colorRGB>> buffers(workerCount(), std::vector<colorRGB>(static_cast<size_t>(rows) * cam.width));
+	auto rowPointer = [&](int i, int worker) { return buffers[worker].data() + static_cast<size_t>(i % rows) * cam.width; };
+	frame.run(0, cam.height, rowPointer, [&](int first, int last, int worker) {
+		for (int i = first; i < last; ++i)
+			rowDone(i, rowPointer(i, worker));
+	});
+	return frame.stats();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+#include "camera.h"
+#include "colorRGB.h"
+#include "hitInfo.h"
+#include "renderContext.h"
+#include "renderSettings.h"
+#include "renderStats.h"
+#include "scanlineSink.h"
+#include "scene.h"
+
+// Local illumination at a hit: ambient plus diffuse and Phong specular from every visible light
+colorRGB shade(const scene& world, renderContext& context, const surfaceInteraction& surface, const glm::vec3& viewDirection);
+
+// Whitted integrator: follows reflection and refraction up to settings.maxDepth, iterating over the
+// context's explicit stack instead of recursing. Branches contributing less than settings.minContribution are culled.
+// Up to shadeBatchSize camera rays go in at once; the hits of each batch are shaded grouped by material
+void traceBatch(const scene& world, renderContext& context, const ray* cameraRays, int count, colorRGB* results);
+colorRGB trace(const scene& world, renderContext& context, const ray& cameraRay);
+
+// Renders one frame into cam.pixels on all render threads and returns the counters summed over them
+renderStats render(const scene& world, camera& cam, const renderSettings& settings);
+
+// Renders into cam.pixels like render(), but leaves out every task whose scanlines [first, last) finished() reports
+// as already in cam.pixels, and passes the scanlines of each task it completes to rowsDone(first, last) from the
+// render thread that completed them. For resuming interrupted renders
+renderStats renderResuming(const scene& world, camera& cam, const renderSettings& settings,
+	const std::function<bool(int first, int last)>& finished, const std::function<void(int first, int last)>& rowsDone);
+
+// Renders one frame into cam.pixels in passes of increasing resolution: every 8th pixel of every 8th scanline, then
+// the pixels completing the grids of every 4th, every 2nd and finally every pixel. A pass only traces pixels no
+// earlier pass did, so the last one leaves the image render() does, up to rounding, for hardly any extra work. After each pass
+// the pixels not traced yet take the color of the traced one above and to their left, and passDone(step) is
+// called with the pass's spacing (8, 4, 2, then 1) while cam.pixels holds that preview
+renderStats renderProgressive(const scene& world, camera& cam, const renderSettings& settings, const std::function<void(int step)>& passDone);
+
+// Renders one frame windowRows scanlines at a time into a single window buffer, handing each finished window to
+// sink before starting the next, so memory stays at one window whatever the image size. cam needs no
+// framebuffer. Stops early if the sink fails
+renderStats renderStreaming(const scene& world, const camera& cam, const renderSettings& settings, int windowRows, scanlineSink& sink);
+
+// Renders one frame without any framebuffer: each render thread keeps only the scanlines it is working on and
+// passes every finished one to rowDone(y, pixels) itself. Scanlines arrive in no particular order, and pixels
+// is only valid during the call
+renderStats renderScanlines(const scene& world, const camera& cam, const renderSettings& settings,
+	const std::function<void(int y, const colorRGB* pixels)>& rowDone);
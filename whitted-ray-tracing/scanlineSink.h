@@ -0,0 +1,12 @@
+#pragma once
+#include "colorRGB.h"
+
+// Receives the scanlines of a frame in order, a band of consecutive rows at a time
+class scanlineSink
+{
+public:
+	virtual ~scanlineSink() {}
+	// rows holds count full scanlines starting at scanline first, back to back, and is only valid during the
+	// call. Returns false if the rows could not be taken, which ends the frame
+	virtual bool writeRows(int first, int count, const colorRGB* rows) = 0;
+};
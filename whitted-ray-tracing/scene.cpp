@@ -0,0 +1,184 @@
+#include "scene.h"
+#include <chrono>
+
+namespace {
+	// Top-level primitive tests handed to the accelerator; remembers which object the closest hit belongs to
+	class objectIntersector : public primitiveIntersector
+	{
+	public:
+		explicit objectIntersector(const scene& world) : world(world), sphereCount(static_cast<int>(world.spheres.size())) {}
+
+		bool intersect(int index, const ray& r, float& tMax) const override {
+			if (index < sphereCount) {
+				float t;
+				if (!world.spheres[index].intersect(r, r.tMin(), tMax, t)) return false;
+				tMax = t;
+				object = index;
+				return true;
+			}
+
+			const instance& inst = world.instances[index - sphereCount];
+			if (!world.meshes[inst.meshIndex].intersect(inst.toObject(r), r.tMin(), tMax, triangle, u, v)) return false;
+			object = index;
+			return true;
+		}
+
+		bool occluded(int index, const ray& r, float tMax) const override {
+			bool blocked;
+			if (index < sphereCount)
+				blocked = world.spheres[index].occluded(r, r.tMin(), tMax);
+			else {
+				const instance& inst = world.instances[index - sphereCount];
+				blocked = world.meshes[inst.meshIndex].occluded(inst.toObject(r), r.tMin(), tMax);
+			}
+			if (blocked) object = index;
+			return blocked;
+		}
+
+		const scene& world;
+		int sphereCount;
+		mutable int object = -1;
+		mutable int triangle = -1;
+		mutable float u = 0.0f;
+		mutable float v = 0.0f;
+	};
+
+	// Any-hit primitive test that lets light through transmissive objects, attenuating it once per surface
+	// crossing. Each object accounts for all of its crossings on the ray at once, so objects the accelerator
+	// hands over again (from other grid cells or kd-tree leaves) are skipped
+	class transmittanceIntersector : public primitiveIntersector
+	{
+	public:
+		static constexpr int maxObjects = 16;
+
+		transmittanceIntersector(const scene& world, float cutoff) : world(world), opaque(world), sphereCount(static_cast<int>(world.spheres.size())), cutoff(cutoff) {}
+
+		bool intersect(int, const ray&, float&) const override { return false; }
+
+		bool occluded(int index, const ray& r, float tMax) const override {
+			float transmissivity = world.materials.transmissivity[world.objectMaterial(index)];
+			if (transmissivity <= 0.0f) return opaque.occluded(index, r, tMax);
+
+			for (int i = 0; i < passedCount; ++i)
+				if (passed[i] == index) return false;
+			int crossings;
+			if (index < sphereCount)
+				crossings = world.spheres[index].crossings(r, r.tMin(), tMax);
+			else {
+				const instance& inst = world.instances[index - sphereCount];
+				crossings = world.meshes[inst.meshIndex].crossings(inst.toObject(r), r.tMin(), tMax);
+			}
+			if (crossings == 0) return false;
+			// Out of room to remember it: count the object as opaque rather than risk attenuating twice
+			if (passedCount == maxObjects) {
+				transmittance = 0.0f;
+				return true;
+			}
+			passed[passedCount++] = index;
+			for (int i = 0; i < crossings; ++i)
+				transmittance *= transmissivity;
+			if (transmittance < cutoff) transmittance = 0.0f;
+			return transmittance == 0.0f;
+		}
+
+		const scene& world;
+		objectIntersector opaque;   // Its object is the opaque blocker, if any
+		int sphereCount;
+		float cutoff;
+		mutable float transmittance = 1.0f;
+		mutable int passed[maxObjects];
+		mutable int passedCount = 0;
+	};
+}
+
+void scene::gatherBounds() {
+	objectBounds.resize(objectCount());
+	for (size_t i = 0; i < spheres.size(); ++i)
+		objectBounds[i] = spheres[i].bounds();
+	for (size_t i = 0; i < instances.size(); ++i)
+		objectBounds[spheres.size() + i] = instances[i].worldBounds(meshes[instances[i].meshIndex].bounds());
+}
+
+void scene::build() {
+	auto start = std::chrono::high_resolution_clock::now();
+	if (materials.empty())
+		materials.add(material());
+	for (mesh& m : meshes)
+		m.build();
+	gatherBounds();
+	accel->build(objectBounds);
+	lightBvh.build(lights);
+	lastUpdateRebuilt = true;
+	lastUpdateTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void scene::update() {
+	auto start = std::chrono::high_resolution_clock::now();
+	gatherBounds();
+	lastUpdateRebuilt = accel->update(objectBounds);
+	lastUpdateTime = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void scene::setAccelerator(acceleratorType type) {
+	accel = createAccelerator(type);
+	gatherBounds();
+	accel->build(objectBounds);
+}
+
+bool scene::intersect(const ray& r, HitInfo& hit) const {
+	float tMax = r.tMax();
+	objectIntersector objects(*this);
+	hit.hit = accel->intersectClosest(r, tMax, objects);
+	if (!hit.hit) return false;
+
+	hit.t = tMax;
+	hit.object = objects.object;
+	hit.primitive = objects.object < static_cast<int>(spheres.size()) ? -1 : objects.triangle;
+	hit.u = objects.u;
+	hit.v = objects.v;
+	return true;
+}
+
+int scene::objectMaterial(int object) const {
+	int sphereCount = static_cast<int>(spheres.size());
+	return object < sphereCount ? spheres[object].material : instances[object - sphereCount].material;
+}
+
+void scene::computeSurfaceInteraction(const ray& r, const HitInfo& hit, surfaceInteraction& surface) const {
+	int sphereCount = static_cast<int>(spheres.size());
+	surface.point = r.at(hit.t);
+	if (hit.object < sphereCount) {
+		const sphere& s = spheres[hit.object];
+		surface.normal = (surface.point - s.center) / s.radius;
+		surface.material = s.material;
+	}
+	else {
+		const instance& inst = instances[hit.object - sphereCount];
+		surface.normal = inst.normalToWorld(meshes[inst.meshIndex].normal(hit.primitive));
+		surface.material = inst.material;
+	}
+}
+
+bool scene::occluded(const ray& r) const {
+	objectIntersector objects(*this);
+	return accel->intersectAny(r, r.tMax(), objects);
+}
+
+bool scene::occluded(const ray& r, int& occluder) const {
+	objectIntersector objects(*this);
+	if (!accel->intersectAny(r, r.tMax(), objects)) return false;
+	occluder = objects.object;
+	return true;
+}
+
+float scene::transmittance(const ray& r, float cutoff, int& occluder) const {
+	transmittanceIntersector objects(*this, cutoff);
+	if (!accel->intersectAny(r, r.tMax(), objects)) return objects.transmittance;
+	if (objects.opaque.object >= 0) occluder = objects.opaque.object;
+	return 0.0f;
+}
+
+bool scene::occludedBy(int object, const ray& r) const {
+	objectIntersector objects(*this);
+	return objects.occluded(object, r, r.tMax());
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "accelerator.h"
+#include "hitInfo.h"
+#include "instance.h"
+#include "light.h"
+#include "lightTree.h"
+#include "material.h"
+#include "mesh.h"
+#include "ray.h"
+#include "sphere.h"
+
+// Two-level scene: the top-level accelerator holds spheres and mesh instances, each mesh carries its own
+// bottom-level BVH. Top-level object indices run over spheres first, then instances.
+class scene
+{
+public:
+	// Builds all acceleration structures from scratch. Needed after objects are added or removed
+	void build();
+
+	// Brings the top-level accelerator up to date after spheres or instances moved. The BVH refits node
+	// bounds in place and only rebuilds once the tree quality has degraded (see bvh::rebuildThreshold).
+	// Meshes whose vertices moved need mesh::refit() first
+	void update();
+
+	// Closest hit within the ray's (tMin, tMax) interval. Records only distance, object, primitive and
+	// barycentrics; call computeSurfaceInteraction for the hit point, normal and material
+	bool intersect(const ray& r, HitInfo& hit) const;
+	void computeSurfaceInteraction(const ray& r, const HitInfo& hit, surfaceInteraction& surface) const;
+	// Shadow ray query: true if anything blocks the ray in (tMin, tMax). Stops at the first blocker
+	// found and never computes hit points or normals
+	bool occluded(const ray& r) const;
+	// Same as above, also reporting which object blocked the ray
+	bool occluded(const ray& r, int& occluder) const;
+	// Fraction of light that makes it along the ray through (tMin, tMax) in a single traversal. Every crossing
+	// of a transmissive object's surface scales it by the material's transmissivity. The first opaque object
+	// returns 0 and is reported through occluder, and so does transmittance falling below cutoff, leaving
+	// occluder as it was
+	float transmittance(const ray& r, float cutoff, int& occluder) const;
+	// Occlusion test against a single object, bypassing the accelerator
+	bool occludedBy(int object, const ray& r) const;
+
+	// Switches the top-level acceleration structure, rebuilding it over the current objects. Call after build()
+	void setAccelerator(acceleratorType type);
+
+	// Material id of a top-level object
+	int objectMaterial(int object) const;
+	int objectCount() const { return static_cast<int>(spheres.size() + instances.size()); }
+
+	std::vector<sphere> spheres;
+	std::vector<mesh> meshes;
+	std::vector<instance> instances;
+	std::vector<light> lights;
+	lightTree lightBvh;     // Built over lights by build(); rebuild it after changing lights
+	materialTable materials;    // A default material is added by build() if none are given
+	std::unique_ptr<accelerator> accel = createAccelerator(acceleratorType::bvh);
+
+	// Duration of the last build() or update() in microseconds, and whether it ended up rebuilding
+	double lastUpdateTime = 0.0;
+	bool lastUpdateRebuilt = false;
+
+private:
+	void gatherBounds();
+
+	std::vector<aabb> objectBounds;
+};
@@ -0,0 +1,115 @@
+#include "scenes.h"
+#include <random>
+#include "glm/ext/matrix_transform.hpp" // glm::translate, glm::scale
+
+namespace {
+	glm::mat4x3 boxTransform(const glm::vec3& center, const glm::vec3& size) {
+		return glm::mat4x3(glm::scale(glm::translate(glm::mat4(1.0f), center), size));
+	}
+}
+
+mesh makeCube() {
+	mesh cube;
+	for (int i = 0; i < 8; ++i)
+		cube.vertices.push_back(glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f));
+
+	// Two counter-clockwise triangles per face, seen from outside
+	const int faces[12][3] = {
+		{ 0, 2, 3 }, { 0, 3, 1 }, { 4, 5, 7 }, { 4, 7, 6 },
+		{ 0, 1, 5 }, { 0, 5, 4 }, { 2, 6, 7 }, { 2, 7, 3 },
+		{ 0, 4, 6 }, { 0, 6, 2 }, { 1, 3, 7 }, { 1, 7, 5 },
+	};
+	for (const auto& f : faces)
+		cube.triangles.push_back(glm::ivec3(f[0], f[1], f[2]));
+	return cube;
+}
+
+sceneView buildParticleScene(scene& world, int count, unsigned seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> radius(0.02f, 0.08f);
+	for (int i = 0; i < count; ++i)
+		world.spheres.push_back(sphere(glm::vec3(position(rng), position(rng), position(rng)), radius(rng)));
+	world.lights.push_back({ glm::vec3(-15.0f, 25.0f, -25.0f), colorRGB(0.5f, 0.5f, 0.5f) });
+	world.lights.push_back({ glm::vec3(20.0f, 5.0f, -15.0f), colorRGB(0.4f, 0.4f, 0.4f) });
+	world.build();
+	return { glm::vec3(0.0f, 0.0f, -30.0f), glm::vec3(0.0f) };
+}
+
+sceneView buildArchitecturalScene(scene& world, int floors, int roomsPerSide, bool roomLights) {
+	world.meshes.push_back(makeCube());
+	const float roomSize = 4.0f;
+	const float storeyHeight = 3.0f;
+	const float wallThickness = 0.15f;
+	float side = roomSize * roomsPerSide;
+
+	for (int floor = 0; floor <= floors; ++floor) {
+		float y = floor * storeyHeight;
+		world.instances.push_back(instance(0, boxTransform(glm::vec3(0.0f, y, 0.0f), glm::vec3(side, 0.2f, side))));
+		if (floor == floors) break;
+
+		// Walls between rooms with a door gap in each, and a column at every corner
+		for (int i = 0; i <= roomsPerSide; ++i) {
+			float offset = -0.5f * side + i * roomSize;
+			for (int j = 0; j < roomsPerSide; ++j) {
+				float start = -0.5f * side + j * roomSize;
+				float wallY = y + 0.5f * storeyHeight;
+				world.instances.push_back(instance(0, boxTransform(glm::vec3(offset, wallY, start + 0.75f * roomSize), glm::vec3(wallThickness, storeyHeight, 0.5f * roomSize))));
+				world.instances.push_back(instance(0, boxTransform(glm::vec3(start + 0.75f * roomSize, wallY, offset), glm::vec3(0.5f * roomSize, storeyHeight, wallThickness))));
+				world.instances.push_back(instance(0, boxTransform(glm::vec3(offset, wallY, start), glm::vec3(0.4f, storeyHeight, 0.4f))));
+			}
+		}
+	}
+
+	// A few lights above the roof plus one under the ceiling of every storey
+	float height = floors * storeyHeight;
+	for (int i = 0; i < 4; ++i) {
+		float x = (i & 1 ? 0.3f : -0.3f) * side;
+		float z = (i & 2 ? 0.3f : -0.3f) * side;
+		world.lights.push_back({ glm::vec3(x, height + 10.0f, z), colorRGB(0.15f, 0.15f, 0.15f) });
+	}
+	for (int floor = 0; floor < floors; ++floor)
+		world.lights.push_back({ glm::vec3(0.5f * roomSize, (floor + 0.9f) * storeyHeight, 0.5f * roomSize), colorRGB(0.05f, 0.05f, 0.05f) });
+	if (roomLights) {
+		for (int floor = 0; floor < floors; ++floor)
+			for (int i = 0; i < roomsPerSide; ++i)
+				for (int j = 0; j < roomsPerSide; ++j) {
+					glm::vec3 center(-0.5f * side + (i + 0.5f) * roomSize, (floor + 0.8f) * storeyHeight, -0.5f * side + (j + 0.5f) * roomSize);
+					world.lights.push_back({ center, colorRGB(1.0f, 0.9f, 0.75f), 2.0f });
+				}
+	}
+	world.build();
+
+	return { glm::vec3(0.8f * side, 1.5f * height + 2.0f, -1.1f * side), glm::vec3(0.0f, 0.4f * height, 0.0f) };
+}
+
+sceneView buildWhittedScene(scene& world) {
+	material floor;
+	floor.diffuse = colorRGB(0.6, 0.6, 0.5);
+	material mirror;
+	mirror.diffuse = colorRGB(0.05, 0.05, 0.05);
+	mirror.specular = colorRGB(0.8, 0.8, 0.8);
+	mirror.shininess = 128.0f;
+	mirror.reflectivity = 0.8f;
+	material glass;
+	glass.diffuse = colorRGB(0.0, 0.0, 0.0);
+	glass.specular = colorRGB(0.9, 0.9, 0.9);
+	glass.shininess = 256.0f;
+	glass.reflectivity = 0.1f;
+	glass.transmissivity = 0.85f;
+	glass.ior = 1.5f;
+	material matte;
+	matte.diffuse = colorRGB(0.8, 0.2, 0.1);
+	matte.specular = colorRGB(0.3, 0.3, 0.3);
+
+	world.meshes.push_back(makeCube());
+	world.instances.push_back(instance(0, boxTransform(glm::vec3(0.0f, -1.1f, 0.0f), glm::vec3(20.0f, 0.2f, 20.0f)), world.materials.add(floor)));
+	world.spheres.push_back(sphere(glm::vec3(-1.2f, 0.0f, 1.0f), 1.0f, world.materials.add(mirror)));
+	world.spheres.push_back(sphere(glm::vec3(0.9f, -0.2f, -0.6f), 0.8f, world.materials.add(glass)));
+	world.spheres.push_back(sphere(glm::vec3(2.2f, -0.5f, 2.0f), 0.5f, world.materials.add(matte)));
+	world.lights.push_back({ glm::vec3(-5.0f, 8.0f, -6.0f), colorRGB(0.6f, 0.6f, 0.6f) });
+	world.lights.push_back({ glm::vec3(6.0f, 5.0f, -2.0f), colorRGB(0.3f, 0.3f, 0.3f) });
+	world.build();
+
+	return { glm::vec3(0.0f, 1.5f, -7.0f), glm::vec3(0.3f, -0.3f, 0.5f) };
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "glm/glm.hpp"
+#include "scene.h"
+
+// Test scenes used by the benchmarks. Each fills an empty scene, builds it and reports a camera that frames it.
+
+struct sceneView {
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+// Unit cube centered on the origin
+mesh makeCube();
+
+// Small spheres spread uniformly through a cube
+sceneView buildParticleScene(scene& world, int count, unsigned seed = 1);
+
+// Floors, walls and columns of a multi-storey building, all instances of one cube mesh. With roomLights every
+// room also gets a short-range ceiling light, for floors * roomsPerSide^2 extra lights
+sceneView buildArchitecturalScene(scene& world, int floors, int roomsPerSide, bool roomLights = false);
+
+// Classic Whitted setup: a mirror sphere and a glass sphere above a diffuse floor, lit by two point lights
+sceneView buildWhittedScene(scene& world);
@@ -0,0 +1,71 @@
+#pragma once
+#include "glm/glm.hpp"
+#include "aabb.h"
+#include "ray.h"
+
+class sphere
+{
+public:
+	sphere(const glm::vec3& center, float radius, int material = 0) : center(center), radius(radius), material(material) {}
+
+	aabb bounds() const { return aabb(center - glm::vec3(radius), center + glm::vec3(radius)); }
+
+	// Finds the nearest intersection with t in (tMin, tMax)
+	bool intersect(const ray& r, float tMin, float tMax, float& t) const {
+		glm::vec3 oc = r.origin() - center;
+		glm::vec3 d = r.direction();
+		float a = glm::dot(d, d);
+		float halfB = glm::dot(oc, d);
+		// Same as halfB^2 - a*c, but measured from the point closest to the center so small, distant
+		// spheres don't lose the discriminant to cancellation
+		glm::vec3 perpendicular = oc - (halfB / a) * d;
+		float discriminant = a * (radius * radius - glm::dot(perpendicular, perpendicular));
+		if (discriminant < 0.0f) return false;
+
+		float sqrtD = glm::sqrt(discriminant);
+		float root = (-halfB - sqrtD) / a;
+		if (root <= tMin || root >= tMax) {
+			root = (-halfB + sqrtD) / a;
+			if (root <= tMin || root >= tMax) return false;
+		}
+		t = root;
+		return true;
+	}
+
+	// Any-hit test: true if the sphere surface crosses the ray anywhere in (tMin, tMax). Skips picking the
+	// nearer root since the distance is never needed
+	bool occluded(const ray& r, float tMin, float tMax) const {
+		glm::vec3 oc = r.origin() - center;
+		glm::vec3 d = r.direction();
+		float a = glm::dot(d, d);
+		float halfB = glm::dot(oc, d);
+		glm::vec3 perpendicular = oc - (halfB / a) * d;
+		float discriminant = a * (radius * radius - glm::dot(perpendicular, perpendicular));
+		if (discriminant < 0.0f) return false;
+
+		float sqrtD = glm::sqrt(discriminant);
+		float nearRoot = (-halfB - sqrtD) / a;
+		float farRoot = (-halfB + sqrtD) / a;
+		return (nearRoot > tMin && nearRoot < tMax) || (farRoot > tMin && farRoot < tMax);
+	}
+
+	// Number of times the ray enters or leaves the sphere in (tMin, tMax)
+	int crossings(const ray& r, float tMin, float tMax) const {
+		glm::vec3 oc = r.origin() - center;
+		glm::vec3 d = r.direction();
+		float a = glm::dot(d, d);
+		float halfB = glm::dot(oc, d);
+		glm::vec3 perpendicular = oc - (halfB / a) * d;
+		float discriminant = a * (radius * radius - glm::dot(perpendicular, perpendicular));
+		if (discriminant < 0.0f) return 0;
+
+		float sqrtD = glm::sqrt(discriminant);
+		float nearRoot = (-halfB - sqrtD) / a;
+		float farRoot = (-halfB + sqrtD) / a;
+		return (nearRoot > tMin && nearRoot < tMax) + (farRoot > tMin && farRoot < tMax);
+	}
+
+	glm::vec3 center;
+	float radius;
+	int material;   // Index into scene::materials
+};
@@ -0,0 +1,93 @@
+#include "tonemap.h"
+#include <cmath>
+#include <cstring>
+#include "parallel.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TONEMAP_SSE2 1
+#endif
+
+namespace {
+	static_assert(sizeof(colorRGB) == 3 * sizeof(double), "rows are read as flat arrays of channels");
+
+	// Fine enough that neighbouring entries are less than one output level apart, even on the steep linear
+	// segment of the curve near black
+	constexpr int srgbTableSize = 4096;
+
+	struct srgbTable {
+		unsigned char levels[srgbTableSize];
+
+		srgbTable() {
+			for (int i = 0; i < srgbTableSize; ++i) {
+				double c = static_cast<double>(i) / (srgbTableSize - 1);
+				double encoded = c <= 0.0031308 ? 12.92 * c : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+				levels[i] = static_cast<unsigned char>(encoded * 255.0 + 0.5);
+			}
+		}
+	};
+
+	const srgbTable& srgbLevels() {
+		static const srgbTable table;
+		return table;
+	}
+
+	// Clamped channel scaled to [0, scale] and rounded
+	int scaledChannel(double c, float exposureScale, float scale) {
+		float v = static_cast<float>(c) * exposureScale;
+		v = v > 0.0f ? (v < 1.0f ? v : 1.0f) : 0.0f;
+		return static_cast<int>(std::lrint(v * scale));   // Nearest, ties to even like the SSE2 conversion
+	}
+}
+
+void quantizeRow(const colorRGB* pixels, int width, const tonemapSettings& settings, unsigned char* out) {
+	const double* channels = &pixels[0].r;
+	int count = 3 * width;
+	float exposureScale = std::exp2(settings.exposure);
+	float scale = settings.srgb ? static_cast<float>(srgbTableSize - 1) : 255.0f;
+	const unsigned char* levels = srgbLevels().levels;
+
+	int i = 0;
+#ifdef TONEMAP_SSE2
+	const __m128 exposure4 = _mm_set1_ps(exposureScale);
+	const __m128 scale4 = _mm_set1_ps(scale);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= count; i += 4) {
+		__m128 v = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(channels + i)), _mm_cvtpd_ps(_mm_loadu_pd(channels + i + 2)));
+		// max returns its second operand for NaN, so NaN clamps to 0
+		v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(v, exposure4), zero), one);
+		__m128i scaled = _mm_cvtps_epi32(_mm_mul_ps(v, scale4));
+		if (settings.srgb) {
+			alignas(16) int index[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(index), scaled);
+			out[i] = levels[index[0]];
+			out[i + 1] = levels[index[1]];
+			out[i + 2] = levels[index[2]];
+			out[i + 3] = levels[index[3]];
+		}
+		else {
+			__m128i words = _mm_packs_epi32(scaled, scaled);
+			int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+			std::memcpy(out + i, &bytes, 4);
+		}
+	}
+#endif
+	for (; i < count; ++i) {
+		int scaled = scaledChannel(channels[i], exposureScale, scale);
+		out[i] = settings.srgb ? levels[scaled] : static_cast<unsigned char>(scaled);
+	}
+}
+
+void quantizeImage(const std::vector<std::vector<colorRGB>>& pixels, const tonemapSettings& settings, unsigned char* out) {
+	int height = static_cast<int>(pixels.size());
+	int width = height > 0 ? static_cast<int>(pixels[0].size()) : 0;
+	parallelFor(height, [&](int i, int) {
+		quantizeRow(pixels[i].data(), width, settings, out + static_cast<size_t>(i) * width * 3);
+	});
+}
+
+void quantizeRows(const colorRGB* rows, int width, int count, const tonemapSettings& settings, unsigned char* out) {
+	parallelFor(count, [&](int i, int) {
+		quantizeRow(rows + static_cast<size_t>(i) * width, width, settings, out + static_cast<size_t>(i) * width * 3);
+	});
+}
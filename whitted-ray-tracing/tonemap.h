@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+#include "colorRGB.h"
+
+// How linear radiance becomes 8-bit display values
+struct tonemapSettings {
+	float exposure = 0.0f;  // In stops: colors are scaled by 2^exposure before clamping
+	bool srgb = true;       // Encode with the sRGB transfer curve rather than storing linear values
+};
+
+// Converts width pixels to interleaved 8-bit RGB: scales by the exposure, clamps to [0, 1] (NaN becomes 0),
+// then encodes and rounds. Four channels at a time with SSE2 where available, sRGB through a lookup table
+void quantizeRow(const colorRGB* pixels, int width, const tonemapSettings& settings, unsigned char* out);
+
+// Quantizes every row into out, 3 bytes per pixel with rows back to back, spread over the render threads
+void quantizeImage(const std::vector<std::vector<colorRGB>>& pixels, const tonemapSettings& settings, unsigned char* out);
+// Same for count contiguous rows of width pixels, as handed to a scanlineSink
+void quantizeRows(const colorRGB* rows, int width, int count, const tonemapSettings& settings, unsigned char* out);